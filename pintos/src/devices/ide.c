@@ -1,6 +1,7 @@
 #include "devices/ide.h"
 #include <ctype.h>
 #include <debug.h>
+#include <list.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include "devices/block.h"
@@ -9,9 +10,16 @@
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Transfers are queued per channel.  A caller submits a request
+   and sleeps until it completes.  The interrupt handler moves the
+   data for PIO requests, and finishes each request.  It then
+   starts the next one, chosen by an elevator (see
+   pick_request()). */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)   /* Data. */
@@ -34,6 +42,7 @@
 #define STA_BSY 0x80  /* Busy. */
 #define STA_DRDY 0x40 /* Device Ready. */
 #define STA_DRQ 0x08  /* Data Request. */
+#define STA_ERR 0x01  /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04 /* Software Reset. */
@@ -49,6 +58,53 @@
 #define CMD_IDENTIFY_DEVICE 0xec    /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20  /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30 /* WRITE SECTOR with retries. */
+#define CMD_READ_DMA 0xc8           /* READ DMA. */
+#define CMD_WRITE_DMA 0xca          /* WRITE DMA. */
+
+/* Most sectors a single command can transfer.  A sector count
+   register value of 0 means this many. */
+#define MAX_SECTORS_PER_COMMAND 256
+
+/* PIIX bus master IDE registers, relative to a channel's
+   bus master base port.  The base ports for both channels come
+   from BAR 4 of the IDE controller's PCI configuration space. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table address. */
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01 /* Start transfer. */
+#define BM_CMD_READ 0x08  /* Transfer from disk to memory. */
+
+/* Bus master Status Register bits. */
+#define BM_STA_INTR 0x04 /* Interrupt (write 1 to clear). */
+#define BM_STA_ERR 0x02  /* Error (write 1 to clear). */
+
+/* PCI configuration mechanism #1 ports. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Physical Region Descriptor: one physically contiguous piece of
+   a DMA transfer.  No region may cross a 64 kB boundary. */
+struct prd {
+  uint32_t addr;  /* Physical address. */
+  uint16_t size;  /* Size in bytes, 0 meaning 64 kB. */
+  uint16_t flags; /* PRD_EOT on the last region. */
+};
+#define PRD_EOT 0x8000 /* End of table. */
+
+/* A transfer of MAX_SECTORS_PER_COMMAND sectors spans at most
+   this many 64 kB-bounded regions. */
+#define PRD_CNT 4
+
+/* A request that has waited this many timer ticks is served
+   next, regardless of the elevator. */
+#define REQUEST_DEADLINE (TIMER_FREQ / 2)
+
+/* Request latencies are kept in a histogram of this many
+   one-tick buckets, the last one also counting anything
+   longer. */
+#define LATENCY_BUCKETS 128
 
 /* An ATA device. */
 struct ata_disk {
@@ -56,6 +112,21 @@ struct ata_disk {
   struct channel* channel; /* Channel that disk is attached to. */
   int dev_no;              /* Device 0 or 1 for master or slave. */
   bool is_ata;             /* Is device an ATA disk? */
+  block_sector_t head;     /* Sector just past the last transfer. */
+};
+
+/* A queued transfer of up to MAX_SECTORS_PER_COMMAND sectors. */
+struct ide_request {
+  struct list_elem elem; /* Element in channel's queue. */
+  struct ata_disk* disk; /* Disk to transfer to or from. */
+  block_sector_t sec_no; /* First sector. */
+  size_t cnt;            /* Number of sectors. */
+  uint8_t* buffer;       /* Data, CNT * BLOCK_SECTOR_SIZE bytes. */
+  bool write;            /* True to write to disk, false to read. */
+  bool dma;              /* True if being transferred by DMA. */
+  size_t xfer_cnt;       /* PIO: sectors moved so far. */
+  int64_t submitted;     /* Timer tick at submission. */
+  struct semaphore done; /* Up'd when the request completes. */
 };
 
 /* An ATA channel (aka controller).
@@ -65,11 +136,21 @@ struct channel {
   uint16_t reg_base; /* Base I/O port. */
   uint8_t irq;       /* Interrupt in use. */
 
-  struct lock lock;                 /* Must acquire to access the controller. */
   bool expecting_interrupt;         /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
   struct semaphore completion_wait; /* Up'd by interrupt handler. */
 
+  uint16_t bm_base; /* Bus master base port, or 0 if no DMA. */
+  struct prd* prdt; /* PRD table for DMA transfers. */
+
+  /* Request queue, protected by disabling interrupts. */
+  struct list queue;          /* Waiting requests, oldest first. */
+  struct ide_request* active; /* Request in progress, or null. */
+
+  /* Statistics. */
+  long long request_cnt;              /* Requests completed. */
+  long long latency[LATENCY_BUCKETS]; /* Requests by ticks to completion. */
+
   struct ata_disk devices[2]; /* The devices on this channel. */
 };
 
@@ -77,16 +158,28 @@ struct channel {
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* PRD tables, one per channel.  The alignment keeps each table
+   from crossing a 64 kB boundary, as the controller requires. */
+static struct prd prd_tables[CHANNEL_CNT][PRD_CNT] __attribute__((aligned(32)));
+
+/* Use bus master DMA where the controller supports it? */
+static bool use_dma = true;
+
 static struct block_operations ide_operations;
 
 static void reset_channel(struct channel*);
 static bool check_device_type(struct ata_disk*);
 static void identify_ata_device(struct ata_disk*);
 
-static void select_sector(struct ata_disk*, block_sector_t);
+static uint16_t find_bus_master(void);
+static void select_sector(struct ata_disk*, block_sector_t, size_t cnt);
 static void issue_pio_command(struct channel*, uint8_t command);
 static void input_sector(struct channel*, void*);
 static void output_sector(struct channel*, const void*);
+static bool dma_ok(const struct channel*, const void* buffer);
+static void start_next(struct channel*);
+static void start_request(struct channel*, struct ide_request*);
+static void finish_request(struct channel*, struct ide_request*);
 
 static void wait_until_idle(const struct ata_disk*);
 static bool wait_while_busy(const struct ata_disk*);
@@ -97,6 +190,7 @@ static void interrupt_handler(struct intr_frame*);
 
 /* Initialize the disk subsystem and detect disks. */
 void ide_init(void) {
+  uint16_t bm_base = find_bus_master();
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
@@ -117,9 +211,12 @@ void ide_init(void) {
       default:
         NOT_REACHED();
     }
-    lock_init(&c->lock);
     c->expecting_interrupt = false;
     sema_init(&c->completion_wait, 0);
+    c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+    c->prdt = prd_tables[chan_no];
+    list_init(&c->queue);
+    c->active = NULL;
 
     /* Initialize devices. */
     for (dev_no = 0; dev_no < 2; dev_no++) {
@@ -128,6 +225,7 @@ void ide_init(void) {
       d->channel = c;
       d->dev_no = dev_no;
       d->is_ata = false;
+      d->head = 0;
     }
 
     /* Register interrupt handler. */
@@ -147,6 +245,58 @@ void ide_init(void) {
   }
 }
 
+/* Enables or disables bus master DMA transfers.  Returns true
+   if DMA is now in use, which requires a bus master IDE
+   controller. */
+bool ide_set_dma(bool enable) {
+  use_dma = enable;
+  return use_dma && channels[0].bm_base != 0;
+}
+
+/* Reads register REG of PCI function BUS:DEV.FUNC. */
+static uint32_t pci_read_config(int bus, int dev, int func, int reg) {
+  outl(PCI_CONFIG_ADDR, 0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (reg & 0xfc));
+  return inl(PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to register REG of PCI function BUS:DEV.FUNC. */
+static void pci_write_config(int bus, int dev, int func, int reg, uint32_t value) {
+  outl(PCI_CONFIG_ADDR, 0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | (reg & 0xfc));
+  outl(PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for an IDE controller capable of bus
+   mastering, such as the PIIX that QEMU emulates.  If one is
+   found, enables bus mastering on it and returns its bus master
+   base port.  Otherwise, returns 0 and all transfers use PIO. */
+static uint16_t find_bus_master(void) {
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++) {
+      uint32_t class, bar;
+
+      if ((pci_read_config(0, dev, func, 0x00) & 0xffff) == 0xffff)
+        continue;
+
+      /* Class 1 (mass storage), subclass 1 (IDE), with the
+         bus master bit set in the programming interface. */
+      class = pci_read_config(0, dev, func, 0x08);
+      if ((class >> 16) != 0x0101 || (class & 0x8000) == 0)
+        continue;
+
+      bar = pci_read_config(0, dev, func, 0x20);
+      if ((bar & 1) == 0 || (bar & ~3u) == 0)
+        continue;
+
+      /* Set the Bus Master Enable bit in the command register,
+         leaving the status half alone. */
+      pci_write_config(0, dev, func, 0x04, (pci_read_config(0, dev, func, 0x04) & 0xffff) | 0x04);
+      return bar & 0xfffc;
+    }
+  return 0;
+}
+
 /* Disk detection and identification. */
 
 static char* descramble_ata_string(char*, int size);
@@ -306,21 +456,83 @@ static char* descramble_ata_string(char* string, int size) {
   return string;
 }
 
+/* Queues a transfer of CNT sectors, at most
+   MAX_SECTORS_PER_COMMAND, between disk D starting at SEC_NO and
+   BUFFER, and waits for it to complete.  Writes to the disk if
+   WRITE is true, otherwise reads. */
+static void submit_request(struct ata_disk* d, block_sector_t sec_no, size_t cnt, void* buffer,
+                           bool write) {
+  struct channel* c = d->channel;
+  struct ide_request r;
+  enum intr_level old_level;
+
+  /* Interrupts must be enabled or our semaphore will never be
+     up'd by the completion handler. */
+  ASSERT(intr_get_level() == INTR_ON);
+  ASSERT(cnt > 0 && cnt <= MAX_SECTORS_PER_COMMAND);
+
+  r.disk = d;
+  r.sec_no = sec_no;
+  r.cnt = cnt;
+  r.buffer = buffer;
+  r.write = write;
+  r.dma = false;
+  r.xfer_cnt = 0;
+  r.submitted = timer_ticks();
+  sema_init(&r.done, 0);
+
+  old_level = intr_disable();
+  list_push_back(&c->queue, &r.elem);
+  if (c->active == NULL)
+    start_next(c);
+  intr_set_level(old_level);
+
+  sema_down(&r.done);
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Each
+   group of up to MAX_SECTORS_PER_COMMAND sectors is a single
+   command: a DMA transfer with one completion interrupt if
+   possible, otherwise PIO with an interrupt per sector.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void ide_read_multiple(void* d, block_sector_t sec_no, size_t cnt, void* buffer_) {
+  uint8_t* buffer = buffer_;
+
+  while (cnt > 0) {
+    size_t n = cnt < MAX_SECTORS_PER_COMMAND ? cnt : MAX_SECTORS_PER_COMMAND;
+    submit_request(d, sec_no, n, buffer, false);
+    sec_no += n;
+    buffer += n * BLOCK_SECTOR_SIZE;
+    cnt -= n;
+  }
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes, in as few
+   commands as ide_read_multiple() would use.  Returns after the
+   disk has acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void ide_write_multiple(void* d, block_sector_t sec_no, size_t cnt, const void* buffer_) {
+  const uint8_t* buffer = buffer_;
+
+  while (cnt > 0) {
+    size_t n = cnt < MAX_SECTORS_PER_COMMAND ? cnt : MAX_SECTORS_PER_COMMAND;
+    submit_request(d, sec_no, n, (void*)buffer, true);
+    sec_no += n;
+    buffer += n * BLOCK_SECTOR_SIZE;
+    cnt -= n;
+  }
+}
+
 /* Reads sector SEC_NO from disk D into BUFFER, which must have
    room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
-static void ide_read(void* d_, block_sector_t sec_no, void* buffer) {
-  struct ata_disk* d = d_;
-  struct channel* c = d->channel;
-  lock_acquire(&c->lock);
-  select_sector(d, sec_no);
-  issue_pio_command(c, CMD_READ_SECTOR_RETRY);
-  sema_down(&c->completion_wait);
-  if (!wait_while_busy(d))
-    PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, sec_no);
-  input_sector(c, buffer);
-  lock_release(&c->lock);
+static void ide_read(void* d, block_sector_t sec_no, void* buffer) {
+  ide_read_multiple(d, sec_no, 1, buffer);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -328,31 +540,214 @@ static void ide_read(void* d_, block_sector_t sec_no, void* buffer) {
    acknowledged receiving the data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
-static void ide_write(void* d_, block_sector_t sec_no, const void* buffer) {
-  struct ata_disk* d = d_;
+static void ide_write(void* d, block_sector_t sec_no, const void* buffer) {
+  ide_write_multiple(d, sec_no, 1, buffer);
+}
+
+static struct block_operations ide_operations = {ide_read, ide_write, ide_read_multiple,
+                                                 ide_write_multiple};
+
+/* Returns true if a transfer to or from BUFFER on channel C can
+   use DMA.  The controller moves data in 16-bit units, so the
+   buffer must be aligned to match. */
+static bool dma_ok(const struct channel* c, const void* buffer) {
+  return use_dma && c->bm_base != 0 && ((uintptr_t)buffer & 1) == 0;
+}
+
+/* Chooses the next request to serve from C's queue, which must
+   not be empty.  Once the oldest request has waited
+   REQUEST_DEADLINE ticks it goes next.  Otherwise the queue is
+   served in C-LOOK order: the request nearest ahead of its disk's
+   head, or, when none is ahead, the lowest-numbered one. */
+static struct ide_request* pick_request(struct channel* c) {
+  struct ide_request* oldest = list_entry(list_front(&c->queue), struct ide_request, elem);
+  struct ide_request* best = NULL;
+  block_sector_t best_dist = 0;
+  struct list_elem* e;
+
+  if (timer_elapsed(oldest->submitted) >= REQUEST_DEADLINE)
+    return oldest;
+
+  for (e = list_begin(&c->queue); e != list_end(&c->queue); e = list_next(e)) {
+    struct ide_request* r = list_entry(e, struct ide_request, elem);
+
+    /* Unsigned, so a sector behind the head is farther than any
+       sector ahead of it. */
+    block_sector_t dist = r->sec_no - r->disk->head;
+    if (best == NULL || dist < best_dist) {
+      best = r;
+      best_dist = dist;
+    }
+  }
+  return best;
+}
+
+/* Starts the next request in C's queue, if there is one.
+   Interrupts must be off. */
+static void start_next(struct channel* c) {
+  struct ide_request* r;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(c->active == NULL);
+
+  if (list_empty(&c->queue))
+    return;
+  r = pick_request(c);
+  list_remove(&r->elem);
+  c->active = r;
+  start_request(c, r);
+}
+
+/* Busy-waits up to about a second for disk D to clear BSY, and
+   then returns the status of the DRQ bit.  Unlike
+   wait_while_busy(), usable with interrupts off. */
+static bool wait_for_drq(const struct ata_disk* d) {
   struct channel* c = d->channel;
-  lock_acquire(&c->lock);
-  select_sector(d, sec_no);
-  issue_pio_command(c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy(d))
-    PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, sec_no);
-  output_sector(c, buffer);
-  sema_down(&c->completion_wait);
-  lock_release(&c->lock);
+  int i;
+
+  for (i = 0; i < 100000; i++) {
+    uint8_t status = inb(reg_alt_status(c));
+    if (!(status & STA_BSY))
+      return (status & STA_DRQ) != 0;
+    timer_udelay(10);
+  }
+  return false;
+}
+
+/* Issues the command for R, which becomes C's active request.
+   For a PIO write, also hands the disk the first sector.  The
+   rest of the transfer is driven by interrupts. */
+static void start_request(struct channel* c, struct ide_request* r) {
+  struct ata_disk* d = r->disk;
+
+  r->dma = dma_ok(c, r->buffer);
+  if (r->dma) {
+    uintptr_t addr = vtop(r->buffer);
+    size_t size = r->cnt * BLOCK_SECTOR_SIZE;
+    int i;
+
+    /* Describe the buffer, splitting it at 64 kB boundaries.
+       It is a kernel virtual address, so it is physically
+       contiguous. */
+    for (i = 0; size > 0; i++) {
+      size_t chunk = 0x10000 - (addr & 0xffff);
+      if (chunk > size)
+        chunk = size;
+      ASSERT(i < PRD_CNT);
+      c->prdt[i].addr = addr;
+      c->prdt[i].size = chunk & 0xffff;
+      c->prdt[i].flags = 0;
+      addr += chunk;
+      size -= chunk;
+    }
+    c->prdt[i - 1].flags = PRD_EOT;
+
+    /* Program the bus master, then the disk, then start. */
+    outl(reg_bm_prdt(c), vtop(c->prdt));
+    outb(reg_bm_command(c), r->write ? 0 : BM_CMD_READ);
+    outb(reg_bm_status(c), inb(reg_bm_status(c)) | BM_STA_INTR | BM_STA_ERR);
+    select_sector(d, r->sec_no, r->cnt);
+    outb(reg_command(c), r->write ? CMD_WRITE_DMA : CMD_READ_DMA);
+    outb(reg_bm_command(c), inb(reg_bm_command(c)) | BM_CMD_START);
+  } else {
+    select_sector(d, r->sec_no, r->cnt);
+    outb(reg_command(c), r->write ? CMD_WRITE_SECTOR_RETRY : CMD_READ_SECTOR_RETRY);
+    if (r->write) {
+      if (!wait_for_drq(d))
+        PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, r->sec_no);
+      output_sector(c, r->buffer);
+      r->xfer_cnt = 1;
+    }
+  }
+}
+
+/* Handles an interrupt for C's active request R.  Moves the next
+   sector of a PIO transfer, or finishes R once all of it has
+   been transferred. */
+static void continue_request(struct channel* c, struct ide_request* r) {
+  struct ata_disk* d = r->disk;
+  uint8_t status = inb(reg_status(c)); /* Acknowledge interrupt. */
+
+  if (r->dma) {
+    uint8_t bm_status;
+
+    outb(reg_bm_command(c), inb(reg_bm_command(c)) & ~BM_CMD_START);
+    bm_status = inb(reg_bm_status(c));
+    outb(reg_bm_status(c), bm_status | BM_STA_INTR | BM_STA_ERR);
+    if ((bm_status & BM_STA_ERR) || (status & STA_ERR))
+      PANIC("%s: disk %s failed, sector=%" PRDSNu, d->name, r->write ? "write" : "read",
+            r->sec_no);
+    finish_request(c, r);
+  } else if (!r->write) {
+    if ((status & (STA_ERR | STA_DRQ)) != STA_DRQ)
+      PANIC("%s: disk read failed, sector=%" PRDSNu, d->name, r->sec_no + r->xfer_cnt);
+    input_sector(c, r->buffer + r->xfer_cnt++ * BLOCK_SECTOR_SIZE);
+    if (r->xfer_cnt == r->cnt)
+      finish_request(c, r);
+  } else {
+    if (status & STA_ERR)
+      PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, r->sec_no + r->xfer_cnt - 1);
+    if (r->xfer_cnt == r->cnt)
+      finish_request(c, r);
+    else {
+      if (!(status & STA_DRQ))
+        PANIC("%s: disk write failed, sector=%" PRDSNu, d->name, r->sec_no + r->xfer_cnt);
+      output_sector(c, r->buffer + r->xfer_cnt++ * BLOCK_SECTOR_SIZE);
+    }
+  }
 }
 
-static struct block_operations ide_operations = {ide_read, ide_write};
+/* Completes C's active request R, wakes up its submitter, and
+   starts the next request. */
+static void finish_request(struct channel* c, struct ide_request* r) {
+  int64_t latency = timer_elapsed(r->submitted);
+
+  r->disk->head = r->sec_no + r->cnt;
+  c->request_cnt++;
+  c->latency[latency < LATENCY_BUCKETS ? latency : LATENCY_BUCKETS - 1]++;
+  c->active = NULL;
+  sema_up(&r->done);
+  start_next(c);
+}
+
+/* Prints, for each channel that has served requests, how many
+   and their 50th percentile, 99th percentile, and maximum
+   latency from submission to completion, in timer ticks. */
+void ide_print_stats(void) {
+  struct channel* c;
+
+  for (c = channels; c < channels + CHANNEL_CNT; c++) {
+    long long seen = 0;
+    int p50 = -1, p99 = -1, max = 0;
+    int i;
+
+    if (c->request_cnt == 0)
+      continue;
+    for (i = 0; i < LATENCY_BUCKETS; i++)
+      if (c->latency[i] > 0) {
+        seen += c->latency[i];
+        if (p50 < 0 && seen * 2 >= c->request_cnt)
+          p50 = i;
+        if (p99 < 0 && seen * 100 >= c->request_cnt * 99)
+          p99 = i;
+        max = i;
+      }
+    printf("%s: %lld requests, latency p50 %d, p99 %d, max %d%s ticks\n", c->name,
+           c->request_cnt, p50, p99, max, max == LATENCY_BUCKETS - 1 ? "+" : "");
+  }
+}
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void select_sector(struct ata_disk* d, block_sector_t sec_no) {
+   writes SEC_NO to the disk's sector selection registers and CNT
+   to the sector count register.  (We use LBA mode.) */
+static void select_sector(struct ata_disk* d, block_sector_t sec_no, size_t cnt) {
   struct channel* c = d->channel;
 
   ASSERT(sec_no < (1UL << 28));
+  ASSERT(cnt > 0 && cnt <= MAX_SECTORS_PER_COMMAND);
 
   select_device_wait(d);
-  outb(reg_nsect(c), 1);
+  outb(reg_nsect(c), cnt & 0xff);
   outb(reg_lbal(c), sec_no);
   outb(reg_lbam(c), sec_no >> 8);
   outb(reg_lbah(c), (sec_no >> 16));
@@ -386,6 +781,8 @@ static void output_sector(struct channel* c, const void* sector) {
 
 /* Wait up to 10 seconds for the controller to become idle, that
    is, for the BSY and DRQ bits to clear in the status register.
+   Busy-waits, so that requests can be started from the interrupt
+   handler.
 
    As a side effect, reading the status register clears any
    pending interrupt. */
@@ -395,7 +792,7 @@ static void wait_until_idle(const struct ata_disk* d) {
   for (i = 0; i < 1000; i++) {
     if ((inb(reg_status(d->channel)) & (STA_BSY | STA_DRQ)) == 0)
       return;
-    timer_usleep(10);
+    timer_udelay(10);
   }
 
   printf("%s: idle timeout\n", d->name);
@@ -432,7 +829,7 @@ static void select_device(const struct ata_disk* d) {
     dev |= DEV_DEV;
   outb(reg_device(c), dev);
   inb(reg_alt_status(c));
-  timer_nsleep(400);
+  timer_ndelay(400);
 }
 
 /* Select disk D in its channel, as select_device(), but wait for
@@ -449,7 +846,9 @@ static void interrupt_handler(struct intr_frame* f) {
 
   for (c = channels; c < channels + CHANNEL_CNT; c++)
     if (f->vec_no == c->irq) {
-      if (c->expecting_interrupt) {
+      if (c->active != NULL)
+        continue_request(c, c->active);
+      else if (c->expecting_interrupt) {
         inb(reg_status(c));           /* Acknowledge interrupt. */
         sema_up(&c->completion_wait); /* Wake up waiter. */
       } else
@@ -1,6 +1,10 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+#include <stdbool.h>
+
 void ide_init(void);
+bool ide_set_dma(bool enable);
+void ide_print_stats(void);
 
 #endif /* devices/ide.h */
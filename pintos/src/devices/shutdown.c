@@ -11,8 +11,13 @@
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "devices/ide.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -118,10 +123,15 @@ static void print_stats(void) {
   thread_print_stats();
 #ifdef FILESYS
   block_print_stats();
+  ide_print_stats();
+  cache_print_stats();
 #endif
   console_print_stats();
   kbd_print_stats();
 #ifdef USERPROG
   exception_print_stats();
 #endif
+#ifdef VM
+  frame_print_stats();
+#endif
 }
@@ -20,6 +20,11 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* Threads sleeping in timer_sleep_until(), in order of wakeup
+   tick, so that each timer interrupt only looks at the threads
+   that are due. */
+static struct list sleep_list;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -33,6 +38,7 @@ static void real_time_delay(int64_t num, int32_t denom);
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void timer_init(void) {
+  list_init(&sleep_list);
   pit_configure_channel(0, 2, TIMER_FREQ);
   intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
@@ -78,12 +84,42 @@ int64_t timer_elapsed(int64_t then) { return timer_ticks() - then; }
 void timer_sleep(int64_t ticks) {
   if (ticks <= 0)
     return;
+  timer_sleep_until(timer_ticks() + ticks, 0);
+}
+
+/* Orders threads by wakeup tick. */
+static bool wakeup_less(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED) {
+  return list_entry(a, struct thread, elem)->wakeup_tick <
+         list_entry(b, struct thread, elem)->wakeup_tick;
+}
+
+/* Sleeps until NS nanoseconds after the timer tick count reaches
+   WAKEUP, so that a deadline can fall between ticks.  NS must be
+   less than one tick.  The whole ticks are slept by blocking, and
+   the rest is busy-waited once the thread runs again, as
+   timer_nsleep() does for sleeps shorter than a tick.  Returns at
+   once if WAKEUP has already passed.  Periodic work that sleeps
+   until absolute deadlines does not drift the way repeated
+   timer_sleep() calls do.  Interrupts must be turned on. */
+void timer_sleep_until(int64_t wakeup, int64_t ns) {
+  struct thread* cur = thread_current();
+  enum intr_level old_level;
+  bool passed;
+
   ASSERT(intr_get_level() == INTR_ON);
-  enum intr_level old_level = intr_disable();
-  struct thread* current_thread = thread_current();
-  current_thread->ticks_blocked = ticks;
-  thread_block();
+  ASSERT(ns >= 0 && ns < 1000 * 1000 * 1000 / TIMER_FREQ);
+
+  old_level = intr_disable();
+  passed = wakeup < ticks;
+  if (wakeup > ticks) {
+    cur->wakeup_tick = wakeup;
+    list_insert_ordered(&sleep_list, &cur->elem, wakeup_less, NULL);
+    thread_block();
+  }
   intr_set_level(old_level);
+
+  if (!passed && ns > 0)
+    real_time_delay(ns, 1000 * 1000 * 1000);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -132,7 +168,17 @@ void timer_print_stats(void) { printf("Timer: %" PRId64 " ticks\n", timer_ticks(
 static void timer_interrupt(struct intr_frame* args UNUSED) {
   ticks++;
 
-  thread_foreach(blocked_thread_check, NULL);
+  /* Wake the sleepers that are due.  Preempt the running thread on
+     return if one of them outranks it. */
+  while (!list_empty(&sleep_list)) {
+    struct thread* t = list_entry(list_front(&sleep_list), struct thread, elem);
+    if (t->wakeup_tick > ticks)
+      break;
+    list_pop_front(&sleep_list);
+    thread_unblock(t);
+    if (t->priority > thread_current()->priority)
+      intr_yield_on_return();
+  }
   if (thread_mlfqs) {
     thread_mlfqs_increase_recent_cpu_by_one();
     if (ticks % TIMER_FREQ == 0)
@@ -1,12 +1,31 @@
 #include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "filesys/cache.h"
 #include "filesys/filesys.h"
+#include "filesys/free-map.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
-#define CACHE_NUM_ENTRIES 64
 #define CACHE_NUM_CHANCES 1
 
+/* Maximum number of sectors waiting for the read-ahead daemon.
+   Requests beyond this are dropped, since read-ahead is only a
+   hint. */
+#define CACHE_READAHEAD_QUEUE_SIZE 64
+
+/* Maximum number of consecutive dirty sectors that write-behind
+   gathers into a single disk write. */
+#define CACHE_WRITE_BEHIND_RUN 64
+
 /* Cache block, each block can hold BLOCK_SECTOR_SIZE bytes of data. */
 struct cache_block {
   struct lock cache_block_lock;
@@ -16,29 +35,160 @@ struct cache_block {
   bool valid;
   bool dirty;
   size_t chances;
+
+  struct list_elem hash_elem; /* Element in a cache_buckets list. */
+  bool hashed;                /* True if linked into cache_buckets. */
+  bool prefetched;            /* Read ahead and not yet used. */
+};
+
+/* Array of cache entries, allocated by cache_init(). */
+static struct cache_block* cache;
+static size_t cache_num_entries = CACHE_DEFAULT_ENTRIES;
+
+/* Milliseconds between write-behind passes, or 0 for none. */
+static unsigned cache_writeback_ms = CACHE_DEFAULT_WRITEBACK_MS;
+
+/* A dirty entry picked up by a write-behind pass. */
+struct cache_dirty_slot {
+  block_sector_t sector; /* Sector the entry held when picked. */
+  int index;             /* Index into cache[]. */
 };
 
-/* Array of cache entries. */
-static struct cache_block cache[CACHE_NUM_ENTRIES];
+/* Hash index from disk sector to cache entry.  Sequential sectors
+   land in consecutive buckets, so masking the sector number is
+   enough to spread them out.  Entries are only linked or unlinked
+   while holding cache_update_lock, and always with interrupts
+   off, so a lookup can probe a bucket with interrupts disabled
+   without taking any lock. */
+static struct list* cache_buckets;
+static size_t cache_num_buckets; /* Power of two, at least cache_num_entries. */
 
-/* A lock for updating cache entries. */
+/* A lock for updating cache entries.  Taken after an entry's
+   cache_block_lock, never before, except by the clock sweep,
+   which only tries entry locks.  No disk I/O happens while it is
+   held. */
 static struct lock cache_update_lock;
 
 /* Used to prevent flush on uninitialized cache if shutdown occurs before cache init. */
 static bool cache_initialized = false;
 
-/* Initialize the cache. */
+/* Statistics. */
+static long long cache_hit_cnt;      /* # of lookups that found their sector. */
+static long long cache_miss_cnt;     /* # of lookups that went to disk. */
+static long long cache_probe_cnt;    /* # of bucket entries examined by lookups. */
+static long long cache_ra_cnt;       /* # of sectors read ahead from disk. */
+static long long cache_ra_hit_cnt;   /* # of read-ahead sectors later used. */
+static long long cache_ra_waste_cnt; /* # of read-ahead sectors evicted unused. */
+static long long cache_wb_cnt;       /* # of sectors written by write-behind. */
+
+/* Sectors queued for the read-ahead daemon, as a ring buffer. */
+static block_sector_t cache_ra_queue[CACHE_READAHEAD_QUEUE_SIZE];
+static size_t cache_ra_head;           /* Index of the next sector to read. */
+static size_t cache_ra_queued;         /* Number of sectors in the queue. */
+static struct lock cache_ra_lock;      /* Protects the queue. */
+static struct condition cache_ra_cond; /* Signaled when a sector is queued. */
+
+/* Returns the bucket that SECTOR_INDEX hashes to. */
+static struct list* cache_bucket(block_sector_t sector_index) {
+  return &cache_buckets[sector_index & (cache_num_buckets - 1)];
+}
+
+/* Sets the number of sectors the cache holds to ENTRIES.
+   Must be called before cache_init(). */
+void cache_configure(size_t entries) {
+  ASSERT(!cache_initialized);
+  if (entries == 0)
+    PANIC("buffer cache must have at least one entry");
+  cache_num_entries = entries;
+}
+
+/* Sets the write-behind interval to MS milliseconds, or disables
+   write-behind if MS is 0.  Must be called before cache_init(). */
+void cache_configure_writeback(unsigned ms) {
+  ASSERT(!cache_initialized);
+  cache_writeback_ms = ms;
+}
+
+/* Initialize the cache.  Entries and hash buckets are carved out
+   of the kernel pool, so the cache can be sized well beyond what
+   would fit in static data. */
 void cache_init(void) {
+  size_t entry_pages, bucket_pages;
+
   lock_init(&cache_update_lock);
+  lock_init(&cache_ra_lock);
+  cond_init(&cache_ra_cond);
+
+  cache_num_buckets = 1;
+  while (cache_num_buckets < cache_num_entries)
+    cache_num_buckets *= 2;
+
+  entry_pages = DIV_ROUND_UP(cache_num_entries * sizeof *cache, PGSIZE);
+  bucket_pages = DIV_ROUND_UP(cache_num_buckets * sizeof *cache_buckets, PGSIZE);
+  cache = palloc_get_multiple(0, entry_pages);
+  cache_buckets = palloc_get_multiple(0, bucket_pages);
+  if (cache == NULL || cache_buckets == NULL)
+    PANIC("can't allocate %zu-entry buffer cache", cache_num_entries);
+
+  for (size_t i = 0; i < cache_num_buckets; i++)
+    list_init(&cache_buckets[i]);
 
   /* Initialize each cache block. */
-  for (int i = 0; i < CACHE_NUM_ENTRIES; i++) {
+  for (size_t i = 0; i < cache_num_entries; i++) {
     cache[i].valid = false;
+    cache[i].hashed = false;
+    cache[i].prefetched = false;
     lock_init(&cache[i].cache_block_lock);
   }
   cache_initialized = true;
 }
 
+/* Returns the index of the entry mapped to SECTOR_INDEX, or -1 if
+   there is none.  The entry's lock is not acquired, so the caller
+   must recheck the mapping once it holds the lock. */
+static int cache_lookup(block_sector_t sector_index) {
+  struct list* bucket = cache_bucket(sector_index);
+  struct list_elem* e;
+  int index = -1;
+
+  enum intr_level old_level = intr_disable();
+  for (e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
+    struct cache_block* b = list_entry(e, struct cache_block, hash_elem);
+    cache_probe_cnt++;
+    if (b->disk_sector_index == sector_index) {
+      index = b - cache;
+      break;
+    }
+  }
+  intr_set_level(old_level);
+  return index;
+}
+
+/* Links the entry at INDEX into the hash index under its current
+   disk_sector_index.  Caller must hold cache_update_lock. */
+static void cache_hash_insert(int index) {
+  ASSERT(lock_held_by_current_thread(&cache_update_lock));
+  ASSERT(!cache[index].hashed);
+
+  enum intr_level old_level = intr_disable();
+  list_push_front(cache_bucket(cache[index].disk_sector_index), &cache[index].hash_elem);
+  cache[index].hashed = true;
+  intr_set_level(old_level);
+}
+
+/* Unlinks the entry at INDEX from the hash index, if it is linked.
+   Caller must hold cache_update_lock. */
+static void cache_hash_remove(int index) {
+  ASSERT(lock_held_by_current_thread(&cache_update_lock));
+
+  enum intr_level old_level = intr_disable();
+  if (cache[index].hashed) {
+    list_remove(&cache[index].hash_elem);
+    cache[index].hashed = false;
+  }
+  intr_set_level(old_level);
+}
+
 /* Writes the block at index to disk. */
 static void cache_flush_block_index(struct block* fs_device, int index) {
   block_write(fs_device, cache[index].disk_sector_index, cache[index].data);
@@ -53,7 +203,7 @@ void cache_flush(struct block* fs_device) {
     return;
 
   /* Write each cache block to disk */
-  for (int i = 0; i < CACHE_NUM_ENTRIES; i++) {
+  for (size_t i = 0; i < cache_num_entries; i++) {
     lock_acquire(&cache[i].cache_block_lock);
     if (cache[i].valid && cache[i].dirty)
       cache_flush_block_index(fs_device, i);
@@ -67,57 +217,99 @@ void cache_invalidate(struct block* fs_device) {
   if (!cache_initialized)
     return;
 
-  lock_acquire(&cache_update_lock);
   /* Invalidate each cache entry. */
-  for (int i = 0; i < CACHE_NUM_ENTRIES; i++) {
+  for (size_t i = 0; i < cache_num_entries; i++) {
     lock_acquire(&cache[i].cache_block_lock);
     if (cache[i].valid && cache[i].dirty)
       cache_flush_block_index(fs_device, i);
     cache[i].valid = false;
+    lock_acquire(&cache_update_lock);
+    cache_hash_remove(i);
+    lock_release(&cache_update_lock);
     lock_release(&cache[i].cache_block_lock);
   }
-  lock_release(&cache_update_lock);
 }
-/* Find a cache entry to evict */
+
+/* Position of the clock hand.  Protected by cache_update_lock. */
+static size_t clock_position = 0;
+
+/* Returns the entry under the clock hand and advances the hand.
+   Caller must hold cache_update_lock. */
+static int cache_clock_advance(void) {
+  int i = clock_position;
+  clock_position = (clock_position + 1) % cache_num_entries;
+  return i;
+}
+
+/* Sweeps the clock hand for an entry to evict.  Entries whose
+   lock is held are in use, so they are skipped rather than
+   waited for.  Returns the index of the victim with its lock
+   held, or -1 if every entry stayed busy through enough of the
+   sweep to have used up all its chances.  Caller must hold
+   cache_update_lock. */
+static int cache_clock_sweep(void) {
+  size_t tries = (CACHE_NUM_CHANCES + 1) * cache_num_entries;
+
+  while (tries-- > 0) {
+    int i = cache_clock_advance();
+    if (!lock_try_acquire(&cache[i].cache_block_lock))
+      continue;
+    if (!cache[i].valid || cache[i].chances == 0)
+      return i;
+    cache[i].chances--;
+    lock_release(&cache[i].cache_block_lock);
+  }
+  return -1;
+}
+
+/* Find a cache entry to evict and remap it to SECTOR_INDEX.
+   Returns the index of the entry with its lock held, or -1 if
+   another thread mapped SECTOR_INDEX in the meantime. */
 static int cache_evict(struct block* fs_device, block_sector_t sector_index) {
-  static size_t clock_position = 0;
+  int i;
+
   lock_acquire(&cache_update_lock);
 
   /* Check to make sure sector_index is not already in the cache. */
-  int i;
-  for (i = 0; i < CACHE_NUM_ENTRIES; i++) {
-    lock_acquire(&cache[i].cache_block_lock);
-    if (cache[i].valid && (cache[i].disk_sector_index == sector_index)) {
-      lock_release(&cache_update_lock);
-      return (-i) - 1;
-    }
-    lock_release(&cache[i].cache_block_lock);
+  if (cache_lookup(sector_index) >= 0) {
+    lock_release(&cache_update_lock);
+    return -1;
   }
 
-  /*  clock algorithm */
-  while (true) {
-    i = clock_position;
-    clock_position++;
-    clock_position %= CACHE_NUM_ENTRIES;
-
+  i = cache_clock_sweep();
+  if (i < 0) {
+    /* Every entry is busy.  Wait for the one under the clock hand,
+       without holding up anyone else's lookups or evictions. */
+    i = cache_clock_advance();
+    lock_release(&cache_update_lock);
     lock_acquire(&cache[i].cache_block_lock);
+  } else
+    lock_release(&cache_update_lock);
 
-    if (!cache[i].valid) {
-      lock_release(&cache_update_lock);
-      return i;
-    }
-
-    if (cache[i].chances == 0)
-      break;
+  /* Write dirty block back to disk.  The old sector stays in the
+     index until this is done, so that a concurrent miss on it waits
+     for our lock instead of reading stale data from disk. */
+  if (cache[i].valid && cache[i].dirty)
+    cache_flush_block_index(fs_device, i);
 
-    cache[i].chances--;
+  lock_acquire(&cache_update_lock);
+  if (cache_lookup(sector_index) >= 0) {
+    /* Another thread brought SECTOR_INDEX in while we wrote.  The
+       victim is clean now and can stay as it is. */
+    lock_release(&cache_update_lock);
     lock_release(&cache[i].cache_block_lock);
+    return -1;
   }
-  lock_release(&cache_update_lock);
-  /* Write dirty block back to disk. */
-  if (cache[i].dirty)
-    cache_flush_block_index(fs_device, i);
+  if (cache[i].valid && cache[i].prefetched)
+    cache_ra_waste_cnt++;
   cache[i].valid = false;
+
+  /* Remap the entry.  Until cache_replace() fills it in, lookups of
+     SECTOR_INDEX find it and wait on its lock. */
+  cache_hash_remove(i);
+  cache[i].disk_sector_index = sector_index;
+  cache_hash_insert(i);
+  lock_release(&cache_update_lock);
   return i;
 }
 
@@ -129,31 +321,49 @@ static void cache_replace(struct block* fs_device, int index, block_sector_t sec
 
   cache[index].valid = true;
   cache[index].dirty = false;
+  cache[index].prefetched = false;
   cache[index].disk_sector_index = sector_index;
   cache[index].chances = CACHE_NUM_CHANCES;
 }
 
-/* sector_index. */
+/* Returns the index of the cache entry holding sector_index, reading it
+   in on a miss.  The entry's cache_block_lock is held on return.
+   PREFETCH is true for the read-ahead daemon, whose lookups do
+   not count as uses of the entry. */
 static int cache_get_block_index(struct block* fs_device, block_sector_t sector_index,
-                                 bool is_whole_block_write) {
-  /* Check if sector_index is in cache. */
-  int i;
-  for (i = 0; i < CACHE_NUM_ENTRIES; i++) {
-    lock_acquire(&cache[i].cache_block_lock);
-    if (cache[i].valid && (cache[i].disk_sector_index == sector_index))
-      break;
-    lock_release(&cache[i].cache_block_lock);
-  }
+                                 bool is_whole_block_write, bool prefetch) {
+  while (true) {
+    /* Check if sector_index is in cache. */
+    int i = cache_lookup(sector_index);
+    if (i >= 0) {
+      lock_acquire(&cache[i].cache_block_lock);
+      if (cache[i].valid && cache[i].disk_sector_index == sector_index) {
+        if (!prefetch) {
+          cache_hit_cnt++;
+          if (cache[i].prefetched) {
+            cache[i].prefetched = false;
+            cache_ra_hit_cnt++;
+          }
+        }
+        return i;
+      }
+      /* Evicted while we waited for the lock; try again. */
+      lock_release(&cache[i].cache_block_lock);
+      continue;
+    }
 
-  /* Evict if sector_index is not in cache. */
-  if (i == CACHE_NUM_ENTRIES) {
+    /* Evict if sector_index is not in cache. */
     i = cache_evict(fs_device, sector_index);
-    if (i >= 0)
+    if (i >= 0) {
       cache_replace(fs_device, i, sector_index, is_whole_block_write);
-    else
-      i = -(i + 1);
+      if (prefetch) {
+        cache[i].prefetched = true;
+        cache_ra_cnt++;
+      } else
+        cache_miss_cnt++;
+      return i;
+    }
   }
-  return i;
 }
 
 /* Read . */
@@ -163,7 +373,7 @@ void cache_read(struct block* fs_device, block_sector_t sector_index, void* dest
   ASSERT(cache_initialized == true);
 
   /* cache_get_block_index () acquires cache_block_lock at index i. */
-  int i = cache_get_block_index(fs_device, sector_index, false);
+  int i = cache_get_block_index(fs_device, sector_index, false, false);
   ASSERT(cache[i].valid == true);
 
   memcpy(destination, cache[i].data + offset, chunk_size);
@@ -178,13 +388,166 @@ void cache_write(struct block* fs_device, block_sector_t sector_index, void* sou
   ASSERT(cache_initialized == true);
   int i;
   if (chunk_size == BLOCK_SECTOR_SIZE)
-    i = cache_get_block_index(fs_device, sector_index, true);
+    i = cache_get_block_index(fs_device, sector_index, true, false);
   else
-    i = cache_get_block_index(fs_device, sector_index, false);
+    i = cache_get_block_index(fs_device, sector_index, false, false);
   ASSERT(cache[i].valid == true);
 
   memcpy(cache[i].data + offset, source, chunk_size);
   cache[i].dirty = true;
   cache[i].chances = CACHE_NUM_CHANCES;
   lock_release(&cache[i].cache_block_lock);
-}
\ No newline at end of file
+}
+
+/* Queues SECTOR_INDEX to be read into the cache by the read-ahead
+   daemon.  Never blocks on disk; if the queue is full the request
+   is dropped. */
+void cache_readahead(block_sector_t sector_index) {
+  if (!cache_initialized)
+    return;
+
+  lock_acquire(&cache_ra_lock);
+  if (cache_ra_queued < CACHE_READAHEAD_QUEUE_SIZE) {
+    size_t tail = (cache_ra_head + cache_ra_queued) % CACHE_READAHEAD_QUEUE_SIZE;
+    cache_ra_queue[tail] = sector_index;
+    cache_ra_queued++;
+    cond_signal(&cache_ra_cond, &cache_ra_lock);
+  }
+  lock_release(&cache_ra_lock);
+}
+
+/* Read-ahead daemon.  Pulls sectors off the queue and loads any
+   that are not already cached, so that the disk transfer overlaps
+   with whatever the reader does next. */
+static void cache_readahead_daemon(void* aux UNUSED) {
+  while (true) {
+    lock_acquire(&cache_ra_lock);
+    while (cache_ra_queued == 0)
+      cond_wait(&cache_ra_cond, &cache_ra_lock);
+    block_sector_t sector_index = cache_ra_queue[cache_ra_head];
+    cache_ra_head = (cache_ra_head + 1) % CACHE_READAHEAD_QUEUE_SIZE;
+    cache_ra_queued--;
+    lock_release(&cache_ra_lock);
+
+    int i = cache_get_block_index(fs_device, sector_index, false, true);
+    lock_release(&cache[i].cache_block_lock);
+  }
+}
+
+/* Starts the read-ahead daemon.  Sectors queued before this is
+   called are read once the daemon runs. */
+void cache_readahead_init(void) {
+  ASSERT(cache_initialized);
+
+  if (thread_create("readahead", PRI_DEFAULT, cache_readahead_daemon, NULL) == TID_ERROR)
+    PANIC("can't start read-ahead daemon");
+}
+
+/* Orders dirty slots by ascending sector. */
+static int cache_dirty_slot_cmp(const void* a_, const void* b_) {
+  const struct cache_dirty_slot* a = a_;
+  const struct cache_dirty_slot* b = b_;
+  return a->sector < b->sector ? -1 : a->sector > b->sector;
+}
+
+/* Writes every dirty entry back to disk.  The entries are visited
+   in ascending sector order, and each run of up to
+   CACHE_WRITE_BEHIND_RUN consecutive dirty sectors is copied into
+   BUFFER and written with a single request.  The entries of a run
+   stay locked until the write completes, so that none of them can
+   be evicted and read back from disk before the disk has their
+   data.  SLOTS must have room for cache_num_entries elements, and
+   BUFFER for CACHE_WRITE_BEHIND_RUN sectors. */
+static void cache_write_behind(struct block* fs_device, struct cache_dirty_slot* slots,
+                               uint8_t* buffer) {
+  int run_index[CACHE_WRITE_BEHIND_RUN];
+  size_t cnt = 0;
+  for (size_t i = 0; i < cache_num_entries; i++)
+    if (cache[i].valid && cache[i].dirty) {
+      slots[cnt].sector = cache[i].disk_sector_index;
+      slots[cnt].index = i;
+      cnt++;
+    }
+  qsort(slots, cnt, sizeof *slots, cache_dirty_slot_cmp);
+
+  size_t i = 0;
+  while (i < cnt) {
+    block_sector_t first = 0;
+    size_t run = 0;
+
+    /* Lock and copy out the next run. */
+    while (i < cnt && run < CACHE_WRITE_BEHIND_RUN) {
+      int index = slots[i].index;
+      if (run > 0 && slots[i].sector != first + run)
+        break;
+
+      lock_acquire(&cache[index].cache_block_lock);
+      i++;
+      /* Skip entries cleaned or evicted since we looked.  Either
+         way the sector is no longer dirty, so the run ends. */
+      if (!cache[index].valid || !cache[index].dirty ||
+          cache[index].disk_sector_index != slots[i - 1].sector) {
+        lock_release(&cache[index].cache_block_lock);
+        if (run > 0)
+          break;
+        continue;
+      }
+
+      if (run == 0)
+        first = slots[i - 1].sector;
+      memcpy(buffer + run * BLOCK_SECTOR_SIZE, cache[index].data, BLOCK_SECTOR_SIZE);
+      run_index[run++] = index;
+    }
+    if (run == 0)
+      continue;
+
+    block_write_multiple(fs_device, first, run, buffer);
+    cache_wb_cnt += run;
+    for (size_t k = 0; k < run; k++) {
+      cache[run_index[k]].dirty = false;
+      lock_release(&cache[run_index[k]].cache_block_lock);
+    }
+  }
+}
+
+/* Write-behind daemon.  Wakes up every cache_writeback_ms
+   milliseconds and cleans the cache, so that evictions rarely
+   have to write a dirty block before reading, and so that a crash
+   loses at most one interval's worth of writes. */
+static void cache_write_behind_daemon(void* aux UNUSED) {
+  int64_t ticks = (int64_t)cache_writeback_ms * TIMER_FREQ / 1000;
+  struct cache_dirty_slot* slots = malloc(cache_num_entries * sizeof *slots);
+  uint8_t* buffer = malloc(CACHE_WRITE_BEHIND_RUN * BLOCK_SECTOR_SIZE);
+  if (slots == NULL || buffer == NULL)
+    PANIC("can't allocate write-behind buffer");
+  if (ticks < 1)
+    ticks = 1;
+
+  while (true) {
+    timer_sleep(ticks);
+    free_map_flush();
+    cache_write_behind(fs_device, slots, buffer);
+  }
+}
+
+/* Starts the write-behind daemon, unless it was disabled with
+   cache_configure_writeback(). */
+void cache_write_behind_init(void) {
+  ASSERT(cache_initialized);
+
+  if (cache_writeback_ms == 0)
+    return;
+  if (thread_create("writebehind", PRI_DEFAULT, cache_write_behind_daemon, NULL) == TID_ERROR)
+    PANIC("can't start write-behind daemon");
+}
+
+/* Prints cache statistics. */
+void cache_print_stats(void) {
+  if (!cache_initialized)
+    return;
+  printf("Cache: %zu entries, %lld hits, %lld misses, %lld probes\n", cache_num_entries,
+         cache_hit_cnt, cache_miss_cnt, cache_probe_cnt);
+  printf("Read-ahead: %lld sectors, %lld used, %lld wasted\n", cache_ra_cnt, cache_ra_hit_cnt,
+         cache_ra_waste_cnt);
+  printf("Write-behind: %lld sectors\n", cache_wb_cnt);
+}
@@ -4,6 +4,19 @@
 #include "off_t.h"
 #include "devices/block.h"
 
+/* Number of sectors cached unless overridden with -cache. */
+#define CACHE_DEFAULT_ENTRIES 64
+
+/* Milliseconds between write-behind passes unless overridden
+   with -writeback. */
+#define CACHE_DEFAULT_WRITEBACK_MS 1000
+
+/* Set the number of cached sectors; must precede cache_init(). */
+void cache_configure(size_t entries);
+
+/* Set the write-behind interval, 0 to disable; must precede cache_init(). */
+void cache_configure_writeback(unsigned ms);
+
 /* Initialize cache. */
 void cache_init(void);
 
@@ -23,4 +36,16 @@ void cache_read(struct block* fs_device, block_sector_t sector_index, void* dest
 void cache_write(struct block* fs_device, block_sector_t sector_index, void* source, off_t offset,
                  int chunk_size);
 
+/* Start the read-ahead daemon. */
+void cache_readahead_init(void);
+
+/* Ask the read-ahead daemon to bring sector_index into the cache. */
+void cache_readahead(block_sector_t sector_index);
+
+/* Start the write-behind daemon. */
+void cache_write_behind_init(void);
+
+/* Print cache statistics. */
+void cache_print_stats(void);
+
 #endif /* filesys/block.h */
\ No newline at end of file
@@ -72,7 +72,9 @@ struct inode* dir_get_inode(struct dir* dir) {
    If successful, returns true, sets *EP to the directory entry
    if EP is non-null, and sets *OFSP to the byte offset of the
    directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
+   otherwise, returns false and ignores EP and OFSP.
+   The caller must hold shared or exclusive access to DIR's
+   inode. */
 static bool lookup(const struct dir* dir, const char* name, struct dir_entry* ep, off_t* ofsp) {
   struct dir_entry e;
   size_t ofs;
@@ -101,10 +103,12 @@ bool dir_lookup(const struct dir* dir, const char* name, struct inode** inode) {
   ASSERT(dir != NULL);
   ASSERT(name != NULL);
 
+  inode_lock_shared(dir->inode);
   if (lookup(dir, name, &e, NULL))
     *inode = inode_open(e.inode_sector);
   else
     *inode = NULL;
+  inode_unlock_shared(dir->inode);
 
   return *inode != NULL;
 }
@@ -127,6 +131,10 @@ bool dir_add(struct dir* dir, const char* name, block_sector_t inode_sector, boo
   if (*name == '\0' || strlen(name) > NAME_MAX)
     return false;
 
+  /* Hold DIR exclusively, so that no other thread can add NAME
+     or take the free slot between our checks and our write. */
+  inode_lock_exclusive(dir->inode);
+
   /* Check that NAME is not in use. */
   if (lookup(dir, name, NULL, NULL))
     goto done;
@@ -168,6 +176,7 @@ bool dir_add(struct dir* dir, const char* name, block_sector_t inode_sector, boo
   //printf("wcs: %d  %d\n",wcs,ofs);
   success = wcs == sizeof e;
 done:
+  inode_unlock_exclusive(dir->inode);
   return success;
 }
 
@@ -181,6 +190,14 @@ bool dir_remove(struct dir* dir, const char* name) {
   off_t ofs;
   ASSERT(dir != NULL);
   ASSERT(name != NULL);
+
+  /* The parent entry names a directory that contains DIR, so it
+     is never empty.  Refusing it here also keeps locks ordered
+     from parent to child below. */
+  if (!strcmp(name, ".."))
+    return false;
+
+  inode_lock_exclusive(dir->inode);
   /* Find directory entry. */
   if (!lookup(dir, name, &e, &ofs))
     goto done;
@@ -207,6 +224,7 @@ bool dir_remove(struct dir* dir, const char* name) {
   inode_remove(inode);
   success = true;
 done:
+  inode_unlock_exclusive(dir->inode);
   if (inode != NULL)
     inode_close(inode);
   return success;
@@ -217,18 +235,22 @@ done:
    contains no more entries. */
 bool dir_readdir(struct dir* dir, char name[NAME_MAX + 1]) {
   struct dir_entry e;
+  bool found = false;
   if (dir->pos == 0) {
     dir->pos = sizeof e;
   }
+  inode_lock_shared(dir->inode);
   for (; /* 0-pos is for parent directory */
        inode_read_at(dir->inode, &e, sizeof e, dir->pos) == sizeof e;) {
     dir->pos += sizeof e;
     if (e.in_use) {
       strlcpy(name, e.name, NAME_MAX + 1);
-      return true;
+      found = true;
+      break;
     }
   }
-  return false;
+  inode_unlock_shared(dir->inode);
+  return found;
 }
 
 bool dir_is_root(struct dir* dir) {
@@ -248,22 +270,28 @@ bool dir_is_same(struct dir* dir1, struct dir* dir2) {
 bool dir_is_empty(struct dir* dir) {
   struct dir_entry e;
   off_t ofs;
+  bool empty = true;
 
+  inode_lock_shared(dir->inode);
   for (ofs = sizeof e; /* 0-pos is for parent directory */
        inode_read_at(dir->inode, &e, sizeof e, ofs) == sizeof e; ofs += sizeof e) {
-    if (e.in_use)
-      return false;
+    if (e.in_use) {
+      empty = false;
+      break;
+    }
   }
-  return true;
+  inode_unlock_shared(dir->inode);
+  return empty;
 }
 
 struct dir* dir_parent(struct dir* dir) {
   struct dir_entry e;
-  off_t ofs;
-
-  for (ofs = 0; /* 0-pos is for parent directory */
-       inode_read_at(dir->inode, &e, sizeof e, ofs) == sizeof e; ofs += sizeof e) {
-    return dir_open(inode_open(e.inode_sector));
-  }
-  return NULL;
+  struct inode* parent = NULL;
+
+  /* 0-pos is for parent directory */
+  inode_lock_shared(dir->inode);
+  if (inode_read_at(dir->inode, &e, sizeof e, 0) == sizeof e)
+    parent = inode_open(e.inode_sector);
+  inode_unlock_shared(dir->inode);
+  return parent != NULL ? dir_open(parent) : NULL;
 }
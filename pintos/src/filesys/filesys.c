@@ -29,6 +29,8 @@ void filesys_init(bool format) {
   if (format)
     do_format();
   free_map_open();
+  cache_readahead_init();
+  cache_write_behind_init();
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -1,43 +1,83 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/synch.h"
 
-static struct file* free_map_file; /* Free map file. */
-static struct bitmap* free_map;    /* Free map, one bit per sector. */
+/* Number of sectors whose bits share one sector of the free map
+   file. */
+#define SECTORS_PER_MAP_SECTOR (BLOCK_SECTOR_SIZE * 8)
+
+static struct file* free_map_file;    /* Free map file. */
+static struct bitmap* free_map;       /* Free map, one bit per sector. */
+static struct bitmap* free_map_dirty; /* Free map file sectors not yet written. */
+static struct lock free_map_lock;     /* Protects the bitmaps above. */
+static size_t free_map_next_fit;      /* Sector to start the next search at. */
 
 /* Initializes the free map. */
 void free_map_init(void) {
   free_map = bitmap_create(block_size(fs_device));
   if (free_map == NULL)
     PANIC("bitmap creation failed--file system device is too large");
+  free_map_dirty = bitmap_create(DIV_ROUND_UP(bitmap_file_size(free_map), BLOCK_SECTOR_SIZE));
+  if (free_map_dirty == NULL)
+    PANIC("bitmap creation failed--file system device is too large");
+  lock_init(&free_map_lock);
   bitmap_mark(free_map, FREE_MAP_SECTOR);
   bitmap_mark(free_map, ROOT_DIR_SECTOR);
 }
 
+/* Notes that the bits for CNT sectors starting at SECTOR have
+   changed, so the free map file sectors holding them must be
+   written by the next free_map_flush(). */
+static void free_map_mark_dirty(block_sector_t sector, size_t cnt) {
+  size_t first = sector / SECTORS_PER_MAP_SECTOR;
+  size_t last = (sector + cnt - 1) / SECTORS_PER_MAP_SECTOR;
+  bitmap_set_multiple(free_map_dirty, first, last - first + 1, true);
+}
+
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
-   written. */
+   sectors were available.  The change reaches the free map file
+   at the next free_map_flush(). */
 bool free_map_allocate(size_t cnt, block_sector_t* sectorp) {
-  block_sector_t sector = bitmap_scan_and_flip(free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR && free_map_file != NULL && !bitmap_write(free_map, free_map_file)) {
-    bitmap_set_multiple(free_map, sector, cnt, false);
-    sector = BITMAP_ERROR;
-  }
-  if (sector != BITMAP_ERROR)
+  lock_acquire(&free_map_lock);
+  block_sector_t sector = bitmap_scan_and_flip_next(free_map, &free_map_next_fit, cnt, false);
+  if (sector != BITMAP_ERROR) {
+    free_map_mark_dirty(sector, cnt);
     *sectorp = sector;
+  }
+  lock_release(&free_map_lock);
   return sector != BITMAP_ERROR;
 }
 
 /* Makes CNT sectors starting at SECTOR available for use. */
 void free_map_release(block_sector_t sector, size_t cnt) {
+  lock_acquire(&free_map_lock);
   ASSERT(bitmap_all(free_map, sector, cnt));
   bitmap_set_multiple(free_map, sector, cnt, false);
-  bitmap_write(free_map, free_map_file);
+  free_map_mark_dirty(sector, cnt);
+  lock_release(&free_map_lock);
+}
+
+/* Writes the sectors of the free map file whose bits changed
+   since the last flush, leaving the rest of the file alone. */
+void free_map_flush(void) {
+  size_t i;
+
+  lock_acquire(&free_map_lock);
+  if (free_map_file != NULL)
+    for (i = 0; i < bitmap_size(free_map_dirty); i++)
+      if (bitmap_test(free_map_dirty, i)) {
+        if (!bitmap_write_part(free_map, free_map_file, i * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE))
+          PANIC("can't write free map");
+        bitmap_reset(free_map_dirty, i);
+      }
+  lock_release(&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -50,7 +90,11 @@ void free_map_open(void) {
 }
 
 /* Writes the free map to disk and closes the free map file. */
-void free_map_close(void) { file_close(free_map_file); }
+void free_map_close(void) {
+  free_map_flush();
+  file_close(free_map_file);
+  free_map_file = NULL;
+}
 
 /* Creates a new free map file on disk and writes the free map to
    it. */
@@ -65,4 +109,5 @@ void free_map_create(void) {
     PANIC("can't open free map");
   if (!bitmap_write(free_map, free_map_file))
     PANIC("can't write free map");
+  bitmap_set_all(free_map_dirty, false);
 }
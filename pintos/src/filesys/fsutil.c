@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ustar.h>
+#include "devices/ide.h"
+#include "devices/timer.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -201,3 +203,74 @@ void fsutil_append(char** argv) {
   file_close(src);
   free(buffer);
 }
+
+/* Number of sectors at the start of the device that the block
+   benchmark transfers over and over. */
+#define BLOCKBENCH_SECTORS 256
+
+/* Transfers the first CNT sectors of BLOCK to or from BUFFER,
+   GROUP sectors per request, repeating for at least a second,
+   and prints the throughput. */
+static void blockbench_run(struct block* block, const char* mode, bool write, size_t group,
+                           uint8_t* buffer, size_t cnt) {
+  unsigned long long bytes = 0, kb_per_sec;
+  int64_t start = timer_ticks();
+  int64_t elapsed;
+  size_t ofs;
+
+  do {
+    for (ofs = 0; ofs + group <= cnt; ofs += group) {
+      if (write)
+        block_write_multiple(block, ofs, group, buffer + ofs * BLOCK_SECTOR_SIZE);
+      else
+        block_read_multiple(block, ofs, group, buffer + ofs * BLOCK_SECTOR_SIZE);
+      bytes += group * BLOCK_SECTOR_SIZE;
+    }
+    elapsed = timer_elapsed(start);
+  } while (elapsed < TIMER_FREQ);
+
+  kb_per_sec = bytes * TIMER_FREQ / elapsed / 1024;
+  printf("%s: %s %-5s %3zu sectors/request: %llu.%02llu MB/s\n", block_name(block), mode,
+         write ? "write" : "read", group, kb_per_sec / 1024, kb_per_sec % 1024 * 100 / 1024);
+}
+
+/* Measures raw block device throughput with one sector and with
+   many sectors per request, in both PIO and DMA mode.  Uses the
+   scratch device if there is one, otherwise the file system
+   device.  Writes only to a scratch device, and then only the
+   data just read from it, so its contents are preserved. */
+void fsutil_blockbench(char** argv UNUSED) {
+  struct block* block = block_get_role(BLOCK_SCRATCH);
+  bool write = block != NULL;
+  size_t pages = DIV_ROUND_UP(BLOCKBENCH_SECTORS * BLOCK_SECTOR_SIZE, PGSIZE);
+  uint8_t* buffer;
+  size_t cnt;
+  int dma;
+
+  if (block == NULL)
+    block = block_get_role(BLOCK_FILESYS);
+  if (block == NULL)
+    PANIC("no block device to benchmark");
+  cnt = block_size(block) < BLOCKBENCH_SECTORS ? block_size(block) : BLOCKBENCH_SECTORS;
+
+  buffer = palloc_get_multiple(PAL_ASSERT, pages);
+  block_read_multiple(block, 0, cnt, buffer);
+
+  printf("Benchmarking '%s' over %zu sectors...\n", block_name(block), cnt);
+  for (dma = 0; dma <= 1; dma++) {
+    const char* mode = dma ? "dma" : "pio";
+    if (ide_set_dma(dma) != dma) {
+      printf("%s: %s not available\n", block_name(block), mode);
+      continue;
+    }
+    blockbench_run(block, mode, false, 1, buffer, cnt);
+    blockbench_run(block, mode, false, cnt, buffer, cnt);
+    if (write) {
+      blockbench_run(block, mode, true, 1, buffer, cnt);
+      blockbench_run(block, mode, true, cnt, buffer, cnt);
+    }
+  }
+  ide_set_dma(true);
+
+  palloc_free_multiple(buffer, pages);
+}
@@ -2,6 +2,7 @@
 
 #include <debug.h>
 #include <round.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include "filesys/filesys.h"
@@ -12,6 +13,9 @@
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of sectors to read ahead of a sequential reader. */
+#define READAHEAD_SECTORS 8
+
 /* Indirect-block structure */
 struct indirect_block_sector {
   block_sector_t block[INDIRECT_BLOCK_COUNT];
@@ -21,66 +25,111 @@ struct indirect_block_sector {
    bytes long. */
 static inline size_t bytes_to_sectors(off_t size) { return DIV_ROUND_UP(size, BLOCK_SECTOR_SIZE); }
 static inline size_t min(size_t x, size_t y) { return x < y ? x : y; }
-static bool inode_allocate(struct inode_disk* disk_inode, off_t length);
+static bool inode_allocate(struct inode_disk* disk_inode, off_t length, struct rwlock* map_lock);
+static size_t inode_allocate_extents(struct inode_disk* disk_inode, size_t num_sectors);
+static bool inode_extents_to_block_map(struct inode_disk* disk_inode, size_t cnt,
+                                       struct rwlock* map_lock);
 static bool inode_allocate_sector(block_sector_t* sector_num);
 static bool inode_allocate_indirect(block_sector_t* sector_num, size_t cnt);
 static bool inode_allocate_doubly_indirect(block_sector_t* sector_num, size_t cnt);
 static void inode_deallocate(struct inode* inode);
+static void inode_deallocate_extents(struct inode_disk* disk_inode);
 static void inode_deallocate_indirect(block_sector_t sector_num, size_t cnt);
 static void inode_deallocate_doubly_indirect(block_sector_t sector_num, size_t cnt);
+static void inode_readahead(struct inode* inode, off_t start, off_t end);
 
-/* Returns the block device sector  */
-static block_sector_t byte_to_sector(const struct inode* inode, off_t pos) {
-  ASSERT(inode != NULL);
-  block_sector_t sector = -1;
-  struct inode_disk* disk_inode = get_inode_disk(inode);
-
-  if (pos < disk_inode->length) {
-    off_t index = pos / BLOCK_SECTOR_SIZE;
-
-    /* direct*/
-    if (index < DIRECT_BLOCK_COUNT)
-      sector = disk_inode->direct_blocks[index];
-    /* indirect*/
-    else if (index < DIRECT_BLOCK_COUNT + INDIRECT_BLOCK_COUNT) {
-
-      index -= DIRECT_BLOCK_COUNT;
+/* Returns entry INDEX of the indirect block in sector SECTOR_NUM.
+   Only the entry itself is copied out of the cache. */
+static block_sector_t indirect_lookup(block_sector_t sector_num, off_t index) {
+  block_sector_t sector;
+  cache_read(fs_device, sector_num, &sector, index * sizeof sector, sizeof sector);
+  return sector;
+}
 
-      struct indirect_block_sector indirect_block;
-      cache_read(fs_device, disk_inode->indirect_block, &indirect_block, 0, BLOCK_SECTOR_SIZE);
-      sector = indirect_block.block[index];
-    }
-    /* doubly indirect*/
-    else {
-      index -= (DIRECT_BLOCK_COUNT + INDIRECT_BLOCK_COUNT);
-      struct indirect_block_sector indirect_block;
+/* Returns the sector holding sector INDEX of an extent-mapped
+   file, or -1 if no extent covers it. */
+static block_sector_t extent_lookup(const struct inode_disk* disk_inode, off_t index) {
+  size_t i;
+  for (i = 0; i < EXTENT_COUNT && disk_inode->extents[i].length > 0; i++) {
+    const struct inode_extent* e = &disk_inode->extents[i];
+    if ((block_sector_t)index < e->length)
+      return e->start + index;
+    index -= e->length;
+  }
+  return -1;
+}
 
-      /* get doubly indirect */
-      int did_index = index / INDIRECT_BLOCK_COUNT;
-      int id_index = index % INDIRECT_BLOCK_COUNT;
+/* Returns the block device sector holding byte offset POS of
+   DISK_INODE, which must already be allocated, whether or not it
+   lies within the inode's length. */
+static block_sector_t offset_to_sector(const struct inode_disk* disk_inode, off_t pos) {
+  off_t index = pos / BLOCK_SECTOR_SIZE;
+  block_sector_t sector;
+
+  /* extents */
+  if (disk_inode->is_extent)
+    sector = extent_lookup(disk_inode, index);
+  /* direct*/
+  else if (index < DIRECT_BLOCK_COUNT)
+    sector = disk_inode->direct_blocks[index];
+  /* indirect*/
+  else if (index < DIRECT_BLOCK_COUNT + INDIRECT_BLOCK_COUNT) {
+    index -= DIRECT_BLOCK_COUNT;
+    sector = indirect_lookup(disk_inode->indirect_block, index);
+  }
+  /* doubly indirect*/
+  else {
+    index -= (DIRECT_BLOCK_COUNT + INDIRECT_BLOCK_COUNT);
 
-      cache_read(fs_device, disk_inode->doubly_indirect_block, &indirect_block, 0,
-                 BLOCK_SECTOR_SIZE);
-      cache_read(fs_device, indirect_block.block[did_index], &indirect_block, 0, BLOCK_SECTOR_SIZE);
+    /* get doubly indirect */
+    int did_index = index / INDIRECT_BLOCK_COUNT;
+    int id_index = index % INDIRECT_BLOCK_COUNT;
 
-      sector = indirect_block.block[id_index];
-    }
+    sector = indirect_lookup(disk_inode->doubly_indirect_block, did_index);
+    sector = indirect_lookup(sector, id_index);
   }
+  return sector;
+}
 
-  free(disk_inode);
+/* Returns the block device sector holding byte offset POS of
+   INODE, which must already be allocated.  Holds the inode's
+   map_lock so that the lookup never sees a map being converted. */
+static block_sector_t inode_sector(struct inode* inode, off_t pos) {
+  block_sector_t sector;
+  rwlock_acquire_read(&inode->map_lock);
+  sector = offset_to_sector(&inode->data, pos);
+  rwlock_release_read(&inode->map_lock);
   return sector;
 }
 
+/* Returns the block device sector  */
+static block_sector_t byte_to_sector(struct inode* inode, off_t pos) {
+  ASSERT(inode != NULL);
+  if (pos < inode->data.length)
+    return inode_sector(inode, pos);
+  return -1;
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and each inode's open_cnt and
+   deny_write_cnt. */
+static struct lock open_inodes_lock;
+
 /* Initializes the inode module. */
-void inode_init(void) { list_init(&open_inodes); }
+void inode_init(void) {
+  list_init(&open_inodes);
+  lock_init(&open_inodes_lock);
+}
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  Regular files are mapped by extents, and switch to
+   the block map if they fragment into more than EXTENT_COUNT
+   runs; directories, which grow an entry at a time between other
+   allocations, use the block map from the start.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool inode_create(block_sector_t sector, off_t length, bool is_dir) {
@@ -97,9 +146,10 @@ bool inode_create(block_sector_t sector, off_t length, bool is_dir) {
   disk_inode = calloc(1, sizeof *disk_inode);
   if (disk_inode != NULL) {
     disk_inode->is_dir = is_dir;
+    disk_inode->is_extent = !is_dir;
     disk_inode->length = length;
     disk_inode->magic = INODE_MAGIC;
-    if (inode_allocate(disk_inode, length)) {
+    if (inode_allocate(disk_inode, length, NULL)) {
       cache_write(fs_device, sector, disk_inode, 0, BLOCK_SECTOR_SIZE);
       success = true;
     }
@@ -115,19 +165,24 @@ struct inode* inode_open(block_sector_t sector) {
   struct list_elem* e;
   struct inode* inode;
 
+  lock_acquire(&open_inodes_lock);
+
   /* Check whether this inode is already open. */
   for (e = list_begin(&open_inodes); e != list_end(&open_inodes); e = list_next(e)) {
     inode = list_entry(e, struct inode, elem);
     if (inode->sector == sector) {
-      inode_reopen(inode);
+      inode->open_cnt++;
+      lock_release(&open_inodes_lock);
       return inode;
     }
   }
 
   /* Allocate memory. */
   inode = malloc(sizeof *inode);
-  if (inode == NULL)
+  if (inode == NULL) {
+    lock_release(&open_inodes_lock);
     return NULL;
+  }
 
   /* Initialize. */
   list_push_front(&open_inodes, &inode->elem);
@@ -135,14 +190,23 @@ struct inode* inode_open(block_sector_t sector) {
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
-  lock_init(&inode->inode_lock);
+  inode->read_next = 0;
+  inode->readahead_end = 0;
+  rwlock_init(&inode->rwlock);
+  rwlock_init(&inode->map_lock);
+  lock_init(&inode->extend_lock);
+  cache_read(fs_device, inode->sector, &inode->data, 0, BLOCK_SECTOR_SIZE);
+  lock_release(&open_inodes_lock);
   return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode* inode_reopen(struct inode* inode) {
-  if (inode != NULL)
+  if (inode != NULL) {
+    lock_acquire(&open_inodes_lock);
     inode->open_cnt++;
+    lock_release(&open_inodes_lock);
+  }
   return inode;
 }
 
@@ -158,8 +222,13 @@ void inode_close(struct inode* inode) {
     return;
 
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0) {
+  lock_acquire(&open_inodes_lock);
+  bool last = --inode->open_cnt == 0;
+  if (last)
     list_remove(&inode->elem);
+  lock_release(&open_inodes_lock);
+
+  if (last) {
     if (inode->removed) {
       free_map_release(inode->sector, 1);
       inode_deallocate(inode);
@@ -205,45 +274,82 @@ off_t inode_read_at(struct inode* inode, void* buffer_, off_t size, off_t offset
     bytes_read += chunk_size;
   }
   offset = offsetou;
+  if (bytes_read > 0)
+    inode_readahead(inode, offset, offset + bytes_read);
   return bytes_read;
 }
 
+/* Notes that bytes START through END of INODE were just read.  If
+   the read picked up where the previous one left off, queues the
+   next READAHEAD_SECTORS sectors that have not been queued yet. */
+static void inode_readahead(struct inode* inode, off_t start, off_t end) {
+  if (start != inode->read_next) {
+    /* Random access; start over. */
+    inode->read_next = end;
+    inode->readahead_end = 0;
+    return;
+  }
+  inode->read_next = end;
+
+  off_t length = inode_length(inode);
+  off_t pos = ROUND_UP(end, BLOCK_SECTOR_SIZE);
+  off_t limit = pos + READAHEAD_SECTORS * BLOCK_SECTOR_SIZE;
+  if (pos < inode->readahead_end)
+    pos = inode->readahead_end;
+  if (limit > length)
+    limit = length;
+
+  for (; pos < limit; pos += BLOCK_SECTOR_SIZE)
+    cache_readahead(byte_to_sector(inode, pos));
+  if (pos > inode->readahead_end)
+    inode->readahead_end = pos;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if an error occurs.  A write past end of file
+   extends the inode.
+
+   Writes within the file run concurrently with each other and
+   with readers; the cache locks each sector.  Extending writes
+   are serialized by the inode's extend_lock, and publish the new
+   length only after the data is in place, so readers never see
+   the new region before it has been written. */
 off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t offset) {
   const uint8_t* buffer = buffer_;
   off_t bytes_written = 0;
+  off_t end = offset + size;
+  off_t length = inode_length(inode);
+  bool extending = false;
 
   if (inode->deny_write_cnt)
     return 0;
 
   /* If new size of the file is past EOF, extend file */
-  if (byte_to_sector(inode, offset + size - 1) == (size_t)-1) {
-    /* Get inode_disk */
-    struct inode_disk* disk_inode = get_inode_disk(inode);
-
-    /* Allocate more sectors */
-    if (!inode_allocate(disk_inode, offset + size)) {
-      free(disk_inode);
-      return bytes_written;
-    }
-
-    /* Update inode_disk */
-    disk_inode->length = offset + size;
-    cache_write(fs_device, inode_get_inumber(inode), (void*)disk_inode, 0, BLOCK_SECTOR_SIZE);
-    free(disk_inode);
+  if (end > length) {
+    lock_acquire(&inode->extend_lock);
+    length = inode_length(inode);
+    if (end > length) {
+      /* Allocate more sectors */
+      if (!inode_allocate(&inode->data, end, &inode->map_lock)) {
+        /* Keep any change of map made before running out. */
+        cache_write(fs_device, inode_get_inumber(inode), &inode->data, 0, BLOCK_SECTOR_SIZE);
+        lock_release(&inode->extend_lock);
+        return bytes_written;
+      }
+      extending = true;
+      length = end;
+    } else
+      lock_release(&inode->extend_lock);
   }
 
   while (size > 0) {
     /* Sector to write, starting byte offset within sector. */
-    block_sector_t sector_idx = byte_to_sector(inode, offset);
+    block_sector_t sector_idx = inode_sector(inode, offset);
     int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
     /* Bytes left in inode, bytes left in sector, lesser of the two. */
-    off_t inode_left = inode_length(inode) - offset;
+    off_t inode_left = length - offset;
     int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
     int min_left = min(inode_left, sector_left);
 
@@ -260,49 +366,46 @@ off_t inode_write_at(struct inode* inode, const void* buffer_, off_t size, off_t
     bytes_written += chunk_size;
   }
 
+  if (extending) {
+    /* Update inode_disk, writing it through to the cache */
+    inode->data.length = end;
+    cache_write(fs_device, inode_get_inumber(inode), &inode->data, 0, BLOCK_SECTOR_SIZE);
+    lock_release(&inode->extend_lock);
+  }
+
   return bytes_written;
 }
 
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void inode_deny_write(struct inode* inode) {
+  lock_acquire(&open_inodes_lock);
   inode->deny_write_cnt++;
   ASSERT(inode->deny_write_cnt <= inode->open_cnt);
+  lock_release(&open_inodes_lock);
 }
 
 /* Re-enables writes to INODE.
    Must be called once by each inode opener who has called
    inode_deny_write() on the inode, before closing the inode. */
 void inode_allow_write(struct inode* inode) {
+  lock_acquire(&open_inodes_lock);
   ASSERT(inode->deny_write_cnt > 0);
   ASSERT(inode->deny_write_cnt <= inode->open_cnt);
   inode->deny_write_cnt--;
-}
-
-/* Reads inode_disk from disk. Make sure to free after. */
-struct inode_disk* get_inode_disk(const struct inode* inode) {
-  ASSERT(inode != NULL);
-  struct inode_disk* disk_inode = malloc(sizeof *disk_inode);
-  cache_read(fs_device, inode_get_inumber(inode), (void*)disk_inode, 0, BLOCK_SECTOR_SIZE);
-  return disk_inode;
+  lock_release(&open_inodes_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
 off_t inode_length(const struct inode* inode) {
   ASSERT(inode != NULL);
-  struct inode_disk* disk_inode = get_inode_disk(inode);
-  off_t len = disk_inode->length;
-  free(disk_inode);
-  return len;
+  return inode->data.length;
 }
 
 /* Returns is_dir of INODE's data. */
 bool inode_is_dir(const struct inode* inode) {
   ASSERT(inode != NULL);
-  struct inode_disk* disk_inode = get_inode_disk(inode);
-  bool is_dir = disk_inode->is_dir;
-  free(disk_inode);
-  return is_dir;
+  return inode->data.is_dir;
 }
 
 /* Returns removed of INODE's data. */
@@ -311,13 +414,27 @@ bool inode_is_removed(const struct inode* inode) {
   return inode->removed;
 }
 
-/* Attempts allocating sectors in the order of direct->indirect->d.indirect */
-static bool inode_allocate(struct inode_disk* disk_inode, off_t length) {
+/* Attempts allocating sectors in the order of direct->indirect->d.indirect.
+   An extent-mapped DISK_INODE that runs out of extents is
+   converted to the block map, holding MAP_LOCK, if non-null,
+   for writing while the map changes. */
+static bool inode_allocate(struct inode_disk* disk_inode, off_t length, struct rwlock* map_lock) {
   ASSERT(disk_inode != NULL);
   if (length < 0)
     return false;
   size_t i, j, num_sectors = bytes_to_sectors(length);
 
+  if (disk_inode->is_extent) {
+    size_t cnt = inode_allocate_extents(disk_inode, num_sectors);
+    if (cnt == num_sectors)
+      return true;
+    /* Out of disk space rather than extents. */
+    if (disk_inode->extents[EXTENT_COUNT - 1].length == 0)
+      return false;
+    if (!inode_extents_to_block_map(disk_inode, cnt, map_lock))
+      return false;
+  }
+
   /* Allocate Direct Blocks */
   j = min(num_sectors, DIRECT_BLOCK_COUNT);
   for (i = 0; i < j; i++)
@@ -346,6 +463,140 @@ static bool inode_allocate(struct inode_disk* disk_inode, off_t length) {
   return false;
 }
 
+/* Grows the extent list of DISK_INODE to cover NUM_SECTORS
+   sectors.  Each missing run is requested from the free map in
+   one piece, halving the request while no run that long is free,
+   and a run that directly follows the last extent extends it.
+   Returns the number of sectors covered, which is less than
+   NUM_SECTORS if the disk or the extent list fills up first. */
+static size_t inode_allocate_extents(struct inode_disk* disk_inode, size_t num_sectors) {
+  static char zeros[BLOCK_SECTOR_SIZE];
+  struct inode_extent* e = NULL;
+  size_t i, used = 0;
+
+  for (i = 0; i < EXTENT_COUNT && disk_inode->extents[i].length > 0; i++) {
+    e = &disk_inode->extents[i];
+    used += e->length;
+  }
+
+  while (used < num_sectors) {
+    size_t cnt = num_sectors - used;
+    block_sector_t start;
+    while (!free_map_allocate(cnt, &start))
+      if ((cnt /= 2) == 0)
+        return used;
+
+    if (e != NULL && e->start + e->length == start)
+      e->length += cnt;
+    else if (i < EXTENT_COUNT) {
+      e = &disk_inode->extents[i++];
+      e->start = start;
+      e->length = cnt;
+    } else {
+      free_map_release(start, cnt);
+      return used;
+    }
+
+    for (; cnt > 0; cnt--, used++)
+      cache_write(fs_device, start++, zeros, 0, BLOCK_SECTOR_SIZE);
+  }
+  return used;
+}
+
+/* Scratch space for inode_extents_to_block_map(). */
+struct map_builder {
+  struct inode_disk map;                  /* New inode. */
+  struct indirect_block_sector indirect;  /* Indirect block being filled. */
+  struct indirect_block_sector doubly;    /* Doubly indirect block. */
+  block_sector_t meta[2 + INDIRECT_BLOCK_COUNT]; /* Indirect, doubly, then its children. */
+};
+
+/* Rewrites the CNT sectors mapped by DISK_INODE's extents as a
+   block map, so that a file fragmented into more runs than there
+   are extents can keep growing.  The data stays where it is; only
+   the indirect blocks the map needs are allocated.  The new map
+   replaces the old one while MAP_LOCK, if non-null, is held for
+   writing.  Returns false, leaving DISK_INODE unchanged, if
+   memory or disk allocation fails. */
+static bool inode_extents_to_block_map(struct inode_disk* disk_inode, size_t cnt,
+                                       struct rwlock* map_lock) {
+  struct map_builder* b;
+  size_t indirect_cnt = 0, meta_cnt, i, k, idx = 0;
+
+  if (cnt > DIRECT_BLOCK_COUNT + INDIRECT_BLOCK_COUNT * (1 + INDIRECT_BLOCK_COUNT))
+    return false;
+  if (cnt > DIRECT_BLOCK_COUNT)
+    indirect_cnt = DIV_ROUND_UP(cnt - DIRECT_BLOCK_COUNT, INDIRECT_BLOCK_COUNT);
+  meta_cnt = indirect_cnt > 1 ? indirect_cnt + 1 : indirect_cnt;
+
+  b = malloc(sizeof *b);
+  if (b == NULL)
+    return false;
+
+  /* Allocate every indirect block up front, so that nothing can
+     fail once the map is being built. */
+  for (i = 0; i < meta_cnt; i++)
+    if (!free_map_allocate(1, &b->meta[i])) {
+      while (i-- > 0)
+        free_map_release(b->meta[i], 1);
+      free(b);
+      return false;
+    }
+
+  b->map = *disk_inode;
+  memset(&b->map, 0, offsetof(struct inode_disk, is_dir));
+  b->map.is_extent = false;
+  memset(&b->indirect, 0, sizeof b->indirect);
+  memset(&b->doubly, 0, sizeof b->doubly);
+
+  for (i = 0; i < EXTENT_COUNT && disk_inode->extents[i].length > 0; i++) {
+    const struct inode_extent* e = &disk_inode->extents[i];
+    for (k = 0; k < e->length; k++, idx++) {
+      block_sector_t sector = e->start + k;
+      size_t ofs, meta;
+
+      if (idx < DIRECT_BLOCK_COUNT) {
+        b->map.direct_blocks[idx] = sector;
+        continue;
+      }
+
+      /* Entry OFS of indirect block META: the single indirect
+         block, then the children of the doubly indirect block. */
+      ofs = idx - DIRECT_BLOCK_COUNT;
+      if (ofs < INDIRECT_BLOCK_COUNT)
+        meta = 0;
+      else {
+        ofs -= INDIRECT_BLOCK_COUNT;
+        meta = 2 + ofs / INDIRECT_BLOCK_COUNT;
+        b->doubly.block[ofs / INDIRECT_BLOCK_COUNT] = b->meta[meta];
+        ofs %= INDIRECT_BLOCK_COUNT;
+      }
+      b->indirect.block[ofs] = sector;
+      if (ofs == INDIRECT_BLOCK_COUNT - 1 || idx == cnt - 1) {
+        cache_write(fs_device, b->meta[meta], &b->indirect, 0, BLOCK_SECTOR_SIZE);
+        memset(&b->indirect, 0, sizeof b->indirect);
+      }
+    }
+  }
+  ASSERT(idx == cnt);
+
+  if (indirect_cnt > 0)
+    b->map.indirect_block = b->meta[0];
+  if (indirect_cnt > 1) {
+    b->map.doubly_indirect_block = b->meta[1];
+    cache_write(fs_device, b->meta[1], &b->doubly, 0, BLOCK_SECTOR_SIZE);
+  }
+
+  if (map_lock != NULL)
+    rwlock_acquire_write(map_lock);
+  *disk_inode = b->map;
+  if (map_lock != NULL)
+    rwlock_release_write(map_lock);
+
+  free(b);
+  return true;
+}
+
 static bool inode_allocate_sector(block_sector_t* sector_num) {
   static char buffer[BLOCK_SECTOR_SIZE];
   if (!*sector_num) {
@@ -405,11 +656,16 @@ static void inode_deallocate(struct inode* inode) {
   ASSERT(inode != NULL);
 
   /* Get inode_disk length in bytes */
-  struct inode_disk* disk_inode = get_inode_disk(inode);
+  struct inode_disk* disk_inode = &inode->data;
   off_t length = disk_inode->length;
   if (length < 0)
     return;
 
+  if (disk_inode->is_extent) {
+    inode_deallocate_extents(disk_inode);
+    return;
+  }
+
   /* Get number of sectors needed */
   size_t i, j, num_sectors = bytes_to_sectors(length);
 
@@ -418,29 +674,32 @@ static void inode_deallocate(struct inode* inode) {
   for (i = 0; i < j; i++)
     free_map_release(disk_inode->direct_blocks[i], 1);
   num_sectors -= j;
-  if (num_sectors == 0) {
-    free(disk_inode);
+  if (num_sectors == 0)
     return;
-  }
 
   /* Deallocate indirect block */
   j = min(num_sectors, INDIRECT_BLOCK_COUNT);
   inode_deallocate_indirect(disk_inode->indirect_block, j);
   num_sectors -= j;
-  if (num_sectors == 0) {
-    free(disk_inode);
+  if (num_sectors == 0)
     return;
-  }
 
   /* Deallocate doubly indirect block */
   j = min(num_sectors, INDIRECT_BLOCK_COUNT * INDIRECT_BLOCK_COUNT);
   inode_deallocate_doubly_indirect(disk_inode->doubly_indirect_block, j);
   num_sectors -= j;
 
-  free(disk_inode);
   ASSERT(num_sectors == 0);
 }
 
+/* Releases every extent of DISK_INODE, including any allocated
+   past its length by a failed extension. */
+static void inode_deallocate_extents(struct inode_disk* disk_inode) {
+  size_t i;
+  for (i = 0; i < EXTENT_COUNT && disk_inode->extents[i].length > 0; i++)
+    free_map_release(disk_inode->extents[i].start, disk_inode->extents[i].length);
+}
+
 static void inode_deallocate_indirect(block_sector_t sector_num, size_t cnt) {
   struct indirect_block_sector indirect_block;
   cache_read(fs_device, sector_num, &indirect_block, 0, BLOCK_SECTOR_SIZE);
@@ -466,8 +725,16 @@ static void inode_deallocate_doubly_indirect(block_sector_t sector_num, size_t c
   free_map_release(sector_num, 1);
 }
 
-/* Acquire the lock of INODE. */
-void inode_acquire_lock(struct inode* inode) { lock_acquire(&(inode->inode_lock)); }
+/* Acquires shared access to INODE, waiting while another thread
+   holds or is waiting for exclusive access. */
+void inode_lock_shared(struct inode* inode) { rwlock_acquire_read(&inode->rwlock); }
+
+/* Releases shared access to INODE. */
+void inode_unlock_shared(struct inode* inode) { rwlock_release_read(&inode->rwlock); }
+
+/* Acquires exclusive access to INODE, waiting until no other
+   thread holds shared or exclusive access. */
+void inode_lock_exclusive(struct inode* inode) { rwlock_acquire_write(&inode->rwlock); }
 
-/* Release the lock of INODE. */
-void inode_release_lock(struct inode* inode) { lock_release(&(inode->inode_lock)); }
\ No newline at end of file
+/* Releases exclusive access to INODE. */
+void inode_unlock_exclusive(struct inode* inode) { rwlock_release_write(&inode->rwlock); }
\ No newline at end of file
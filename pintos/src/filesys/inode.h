@@ -8,16 +8,33 @@
 /* Block Sector Counts */
 #define DIRECT_BLOCK_COUNT 123
 #define INDIRECT_BLOCK_COUNT 128
+#define EXTENT_COUNT 62
 
 struct bitmap;
+
+/* A run of LENGTH consecutive sectors starting at START. */
+struct inode_extent {
+  block_sector_t start;
+  block_sector_t length;
+};
+
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk {
-  block_sector_t direct_blocks[DIRECT_BLOCK_COUNT];
-  block_sector_t indirect_block;
-  block_sector_t doubly_indirect_block;
+  union {
+    /* Block map, used unless is_extent is set. */
+    struct {
+      block_sector_t direct_blocks[DIRECT_BLOCK_COUNT];
+      block_sector_t indirect_block;
+      block_sector_t doubly_indirect_block;
+    };
+    /* Extent list, used if is_extent is set.  Unused entries
+       have a length of 0 and follow all used ones. */
+    struct inode_extent extents[EXTENT_COUNT];
+  };
 
   bool is_dir;    /* Indicator of directory file */
+  bool is_extent; /* Data mapped by extents, not the block map. */
   off_t length;   /* File size in bytes. */
   unsigned magic; /* Magic number. */
 };
@@ -26,9 +43,21 @@ struct inode {
   struct list_elem elem;  /* Element in inode list. */
   block_sector_t sector;  /* Sector number of disk location. */
   int open_cnt;           /* Number of openers. */
-  struct lock inode_lock; /* Inode lock. */
   bool removed;           /* True if deleted, false otherwise. */
   int deny_write_cnt;     /* 0: writes ok, >0: deny writes. */
+  off_t read_next;        /* Offset just past the last read. */
+  off_t readahead_end;    /* Read-ahead has been queued up to here. */
+  struct inode_disk data; /* Inode content, written through on change. */
+
+  /* Reader/writer lock for callers that need a consistent view
+     of the contents, such as directory operations. */
+  struct rwlock rwlock;
+
+  /* Held for writing while an extent-mapped file is converted to
+     the block map, and for reading around each sector lookup. */
+  struct rwlock map_lock;
+
+  struct lock extend_lock; /* Serializes growth of the file. */
 };
 
 void inode_init(void);
@@ -42,12 +71,13 @@ off_t inode_read_at(struct inode*, void*, off_t size, off_t offset);
 off_t inode_write_at(struct inode*, const void*, off_t size, off_t offset);
 void inode_deny_write(struct inode*);
 void inode_allow_write(struct inode*);
-struct inode_disk* get_inode_disk(const struct inode*);
 off_t inode_length(const struct inode*);
 bool inode_is_dir(const struct inode*);
 bool inode_is_removed(const struct inode*);
 
-void inode_acquire_lock(struct inode* inode);
-void inode_release_lock(struct inode* inode);
+void inode_lock_shared(struct inode* inode);
+void inode_unlock_shared(struct inode* inode);
+void inode_lock_exclusive(struct inode* inode);
+void inode_unlock_exclusive(struct inode* inode);
 
 #endif /* filesys/inode.h */
\ No newline at end of file
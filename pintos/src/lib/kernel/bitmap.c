@@ -33,6 +33,8 @@ struct bitmap {
    numbered BIT_IDX. */
 static inline size_t elem_idx(size_t bit_idx) { return bit_idx / ELEM_BITS; }
 
+static size_t scan_range(const struct bitmap*, size_t start, size_t last, size_t cnt, bool);
+
 /* Returns an elem_type where only the bit corresponding to
    BIT_IDX is turned on. */
 static inline elem_type bit_mask(size_t bit_idx) { return (elem_type)1 << (bit_idx % ELEM_BITS); }
@@ -193,19 +195,37 @@ size_t bitmap_count(const struct bitmap* b, size_t start, size_t cnt, bool value
   return value_cnt;
 }
 
+/* Returns the index of the first bit in B between START and END,
+   exclusive, that is set to VALUE, or END if there is none.
+   Elements with no bit set to VALUE are skipped whole. */
+static size_t find_bit(const struct bitmap* b, size_t start, size_t end, bool value) {
+  size_t idx = elem_idx(start);
+  elem_type flip = value ? 0 : (elem_type)-1;
+  elem_type elem;
+
+  if (start >= end)
+    return end;
+
+  /* Bits of the first element below START don't count. */
+  elem = (b->bits[idx] ^ flip) & ~(bit_mask(start) - 1);
+  while (elem == 0) {
+    if (++idx >= elem_cnt(end))
+      return end;
+    elem = b->bits[idx] ^ flip;
+  }
+
+  start = idx * ELEM_BITS + __builtin_ctzl(elem);
+  return start < end ? start : end;
+}
+
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool bitmap_contains(const struct bitmap* b, size_t start, size_t cnt, bool value) {
-  size_t i;
-
   ASSERT(b != NULL);
   ASSERT(start <= b->bit_cnt);
   ASSERT(start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test(b, start + i) == value)
-      return true;
-  return false;
+  return find_bit(b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -236,12 +256,33 @@ size_t bitmap_scan(const struct bitmap* b, size_t start, size_t cnt, bool value)
   ASSERT(b != NULL);
   ASSERT(start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) {
-    size_t last = b->bit_cnt - cnt;
-    size_t i;
-    for (i = start; i <= last; i++)
-      if (!bitmap_contains(b, i, cnt, !value))
-        return i;
+  if (cnt <= b->bit_cnt)
+    return scan_range(b, start, b->bit_cnt - cnt, cnt, value);
+  return BITMAP_ERROR;
+}
+
+/* Finds the first group of CNT consecutive bits in B that are all
+   set to VALUE and start between START and LAST, inclusive.
+   Returns the index of the group's first bit, or BITMAP_ERROR if
+   there is none.  Each bit is examined about once: after a bit
+   that ends a candidate group, the search resumes just past it. */
+static size_t scan_range(const struct bitmap* b, size_t start, size_t last, size_t cnt,
+                         bool value) {
+  size_t i = start;
+
+  if (cnt == 0)
+    return start <= last ? start : BITMAP_ERROR;
+
+  while (i <= last) {
+    size_t mismatch;
+
+    i = find_bit(b, i, last + 1, value);
+    if (i > last)
+      break;
+    mismatch = find_bit(b, i, i + cnt, !value);
+    if (mismatch == i + cnt)
+      return i;
+    i = mismatch + 1;
   }
   return BITMAP_ERROR;
 }
@@ -260,6 +301,32 @@ size_t bitmap_scan_and_flip(struct bitmap* b, size_t start, size_t cnt, bool val
   return idx;
 }
 
+/* Like bitmap_scan_and_flip(), but next-fit: searches from *HINT
+   to the end of B, then wraps around to search groups starting
+   before *HINT.  On success, advances *HINT just past the group
+   found, so that repeated allocations don't rescan the bits
+   already handed out.  *HINT may be any value; it starts out as
+   0. */
+size_t bitmap_scan_and_flip_next(struct bitmap* b, size_t* hint, size_t cnt, bool value) {
+  size_t start = *hint <= b->bit_cnt ? *hint : 0;
+  size_t idx = BITMAP_ERROR;
+
+  ASSERT(b != NULL);
+
+  if (cnt <= b->bit_cnt) {
+    size_t last = b->bit_cnt - cnt;
+    idx = scan_range(b, start, last, cnt, value);
+    if (idx == BITMAP_ERROR && start > 0)
+      idx = scan_range(b, 0, start - 1 < last ? start - 1 : last, cnt, value);
+  }
+
+  if (idx != BITMAP_ERROR) {
+    bitmap_set_multiple(b, idx, cnt, !value);
+    *hint = idx + cnt;
+  }
+  return idx;
+}
+
 /* File input and output. */
 
 #ifdef FILESYS
@@ -284,6 +351,18 @@ bool bitmap_write(const struct bitmap* b, struct file* file) {
   off_t size = byte_cnt(b->bit_cnt);
   return file_write_at(file, b->bits, size, 0) == size;
 }
+
+/* Writes the SIZE bytes of B's file image that start at byte
+   OFS to the same place in FILE, clipped to the end of the
+   image.  Return true if successful, false otherwise. */
+bool bitmap_write_part(const struct bitmap* b, struct file* file, size_t ofs, size_t size) {
+  size_t file_size = byte_cnt(b->bit_cnt);
+  if (ofs >= file_size)
+    return true;
+  if (size > file_size - ofs)
+    size = file_size - ofs;
+  return file_write_at(file, (const uint8_t*)b->bits + ofs, size, ofs) == (off_t)size;
+}
 #endif /* FILESYS */
 
 /* Debugging. */
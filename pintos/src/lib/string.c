@@ -1,5 +1,67 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below move whole 32-bit words where they
+   can.  A word that may be unaligned and may alias any other
+   type. */
+typedef uint32_t word_t __attribute__((__may_alias__, __aligned__(1)));
+
+/* Blocks shorter than this are handled a byte at a time. */
+#define WORD_MIN 16
+
+/* Blocks at least this long are copied or set with the x86 string
+   instructions, which beat a word loop once their startup cost is
+   paid off. */
+#define REP_MIN 256
+
+/* Copies SIZE bytes from SRC to DST, low addresses first, and
+   returns DST + SIZE.  Safe for overlapping blocks only if DST is
+   below SRC. */
+static unsigned char* copy_forward(unsigned char* dst, const unsigned char* src, size_t size) {
+  if (size >= WORD_MIN) {
+    size_t words;
+
+    /* Align DST; SRC may stay unaligned, which x86 handles. */
+    for (; (uintptr_t)dst % sizeof(uint32_t) != 0; size--)
+      *dst++ = *src++;
+
+    words = size / sizeof(uint32_t);
+    size %= sizeof(uint32_t);
+    if (words >= REP_MIN / sizeof(uint32_t))
+      asm volatile("rep movsl" : "+D"(dst), "+S"(src), "+c"(words) : : "memory");
+    else
+      for (; words > 0; words--) {
+        *(word_t*)dst = *(const word_t*)src;
+        dst += sizeof(uint32_t);
+        src += sizeof(uint32_t);
+      }
+  }
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst;
+}
+
+/* Copies SIZE bytes from SRC to DST, high addresses first.  Safe
+   for overlapping blocks with DST above SRC. */
+static void copy_backward(unsigned char* dst, const unsigned char* src, size_t size) {
+  dst += size;
+  src += size;
+
+  if (size >= WORD_MIN) {
+    for (; (uintptr_t)dst % sizeof(uint32_t) != 0; size--)
+      *--dst = *--src;
+    for (; size >= sizeof(uint32_t); size -= sizeof(uint32_t)) {
+      dst -= sizeof(uint32_t);
+      src -= sizeof(uint32_t);
+      *(word_t*)dst = *(const word_t*)src;
+    }
+  }
+
+  while (size-- > 0)
+    *--dst = *--src;
+}
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -10,8 +72,7 @@ void* memcpy(void* dst_, const void* src_, size_t size) {
   ASSERT(dst != NULL || size == 0);
   ASSERT(src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  copy_forward(dst, src, size);
 
   return dst_;
 }
@@ -25,17 +86,12 @@ void* memmove(void* dst_, const void* src_, size_t size) {
   ASSERT(dst != NULL || size == 0);
   ASSERT(src != NULL || size == 0);
 
-  if (dst < src) {
-    while (size-- > 0)
-      *dst++ = *src++;
-  } else {
-    dst += size;
-    src += size;
-    while (size-- > 0)
-      *--dst = *--src;
-  }
+  if (dst < src)
+    copy_forward(dst, src, size);
+  else if (dst > src)
+    copy_backward(dst, src, size);
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -49,6 +105,15 @@ int memcmp(const void* a_, const void* b_, size_t size) {
   ASSERT(a != NULL || size == 0);
   ASSERT(b != NULL || size == 0);
 
+  /* Skip equal words; the bytes of the first unequal word, if
+     any, are compared below. */
+  for (; size >= sizeof(uint32_t); size -= sizeof(uint32_t)) {
+    if (*(const word_t*)a != *(const word_t*)b)
+      break;
+    a += sizeof(uint32_t);
+    b += sizeof(uint32_t);
+  }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -247,6 +312,24 @@ void* memset(void* dst_, int value, size_t size) {
 
   ASSERT(dst != NULL || size == 0);
 
+  if (size >= WORD_MIN) {
+    uint32_t word = (unsigned char)value * 0x01010101u;
+    size_t words;
+
+    for (; (uintptr_t)dst % sizeof(uint32_t) != 0; size--)
+      *dst++ = value;
+
+    words = size / sizeof(uint32_t);
+    size %= sizeof(uint32_t);
+    if (words >= REP_MIN / sizeof(uint32_t))
+      asm volatile("rep stosl" : "+D"(dst), "+c"(words) : "a"(word) : "memory");
+    else
+      for (; words > 0; words--) {
+        *(word_t*)dst = word;
+        dst += sizeof(uint32_t);
+      }
+  }
+
   while (size-- > 0)
     *dst++ = value;
 
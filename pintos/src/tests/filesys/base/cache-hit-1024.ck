@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-hit-1024) begin
+(cache-hit-1024) create "hot"
+(cache-hit-1024) open "hot"
+(cache-hit-1024) write "hot"
+(cache-hit-1024) read "hot" 200 times
+(cache-hit-1024) close "hot"
+(cache-hit-1024) end
+EOF
+pass;
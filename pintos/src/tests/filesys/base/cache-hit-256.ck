@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-hit-256) begin
+(cache-hit-256) create "hot"
+(cache-hit-256) open "hot"
+(cache-hit-256) write "hot"
+(cache-hit-256) read "hot" 200 times
+(cache-hit-256) close "hot"
+(cache-hit-256) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+/* Writes a file that fills half of a 64-entry buffer cache,
+   leaving the rest for metadata, then reads it back many times so
+   that nearly every lookup is a cache hit.  The kernel's "Cache:"
+   statistics line at shutdown reports how many bucket probes
+   those hits cost, with the cache as full as it gets in use. */
+
+#define SECTOR_CNT 32
+#include "tests/filesys/base/cache-hit.inc"
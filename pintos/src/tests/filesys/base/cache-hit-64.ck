@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cache-hit-64) begin
+(cache-hit-64) create "hot"
+(cache-hit-64) open "hot"
+(cache-hit-64) write "hot"
+(cache-hit-64) read "hot" 200 times
+(cache-hit-64) close "hot"
+(cache-hit-64) end
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Child process for syn-random test.
+   Reads READ_CNT randomly chosen blocks of the test file, in an
+   order that depends on the child's index, and checks each one
+   against the expected contents. */
+
+#include <random.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/base/syn-random.h"
+
+const char* test_name = "child-syn-random";
+
+static char buf[BUF_SIZE];
+static char block[BLOCK_SIZE];
+
+int main(int argc, const char* argv[]) {
+  int child_idx;
+  int fd;
+  int i;
+
+  quiet = true;
+
+  CHECK(argc == 2, "argc must be 2, actually %d", argc);
+  child_idx = atoi(argv[1]);
+
+  random_init(0);
+  random_bytes(buf, sizeof buf);
+  random_init(child_idx + 1);
+
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  for (i = 0; i < READ_CNT; i++) {
+    size_t ofs = random_ulong() % BLOCK_CNT * BLOCK_SIZE;
+    seek(fd, ofs);
+    CHECK(read(fd, block, BLOCK_SIZE) == BLOCK_SIZE, "read \"%s\"", file_name);
+    compare_bytes(block, buf + ofs, BLOCK_SIZE, ofs, file_name);
+  }
+  close(fd);
+
+  return child_idx;
+}
@@ -0,0 +1,37 @@
+/* Writes a file that reaches into the indirect block, then reads
+   it back a few bytes at a time.  Each small read costs one
+   sector lookup, so the "Cache:" hit count at shutdown, divided
+   by the file size, gives the per-byte metadata cost of reading
+   through the inode layer. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (136 * 512)
+#define CHUNK_SIZE 32
+
+static const char file_name[] = "small";
+static char buf[FILE_SIZE];
+static char rbuf[FILE_SIZE];
+
+void test_main(void) {
+  size_t ofs;
+  int fd;
+
+  random_bytes(buf, sizeof buf);
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  CHECK(write(fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+
+  msg("read \"%s\" %d bytes at a time", file_name, CHUNK_SIZE);
+  seek(fd, 0);
+  for (ofs = 0; ofs < sizeof rbuf; ofs += CHUNK_SIZE)
+    if (read(fd, rbuf + ofs, CHUNK_SIZE) != CHUNK_SIZE)
+      fail("read %d bytes at offset %zu in \"%s\" failed", CHUNK_SIZE, ofs, file_name);
+  compare_bytes(rbuf, buf, sizeof buf, 0, file_name);
+
+  msg("close \"%s\"", file_name);
+  close(fd);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(small-reads) begin
+(small-reads) create "small"
+(small-reads) open "small"
+(small-reads) write "small"
+(small-reads) read "small" 32 bytes at a time
+(small-reads) close "small"
+(small-reads) end
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Spawns 4 child processes, each of which reads randomly chosen
+   blocks of a file much larger than the buffer cache.  The
+   children's cache misses compete for the disk, so the request
+   queue has several requests to order at once.  Aggregate
+   throughput (disk reads against timer ticks) and tail latency
+   of disk requests are reported in the kernel's statistics at
+   shutdown. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/base/syn-random.h"
+
+static char buf[BUF_SIZE];
+
+#define CHILD_CNT 4
+
+void test_main(void) {
+  pid_t children[CHILD_CNT];
+  int fd;
+
+  CHECK(create(file_name, 0), "create \"%s\"", file_name);
+  CHECK((fd = open(file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes(buf, sizeof buf);
+  CHECK(write(fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  msg("close \"%s\"", file_name);
+  close(fd);
+
+  exec_children("child-syn-random", children, CHILD_CNT);
+  wait_children(children, CHILD_CNT);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(syn-random) begin
+(syn-random) create "random"
+(syn-random) open "random"
+(syn-random) write "random"
+(syn-random) close "random"
+(syn-random) exec child 1 of 4: "child-syn-random 0"
+(syn-random) exec child 2 of 4: "child-syn-random 1"
+(syn-random) exec child 3 of 4: "child-syn-random 2"
+(syn-random) exec child 4 of 4: "child-syn-random 3"
+(syn-random) wait for child 1 of 4 returned 0 (expected 0)
+(syn-random) wait for child 2 of 4 returned 1 (expected 1)
+(syn-random) wait for child 3 of 4 returned 2 (expected 2)
+(syn-random) wait for child 4 of 4 returned 3 (expected 3)
+(syn-random) end
+EOF
+pass;
@@ -0,0 +1,10 @@
+#ifndef TESTS_FILESYS_BASE_SYN_RANDOM_H
+#define TESTS_FILESYS_BASE_SYN_RANDOM_H
+
+#define BLOCK_SIZE 512
+#define BLOCK_CNT 256
+#define BUF_SIZE (BLOCK_SIZE * BLOCK_CNT)
+#define READ_CNT 100
+static const char file_name[] = "random";
+
+#endif /* tests/filesys/base/syn-random.h */
@@ -0,0 +1,50 @@
+/* Grows two files in parallel one sector at a time, so that
+   each ends up in many more separate runs of sectors than an
+   inode has extents, and checks that their contents are
+   correct. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_CNT 160
+#define FILE_SIZE (SECTOR_CNT * 512)
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+
+static void write_sector(const char* file_name, int fd, const char* buf, size_t ofs) {
+  size_t ret_val = write(fd, buf + ofs, 512);
+  if (ret_val != 512)
+    fail("write 512 bytes at offset %zu in \"%s\" returned %zu", ofs, file_name, ret_val);
+}
+
+void test_main(void) {
+  int fd_a, fd_b;
+  size_t ofs;
+
+  random_init(0);
+  random_bytes(buf_a, sizeof buf_a);
+  random_bytes(buf_b, sizeof buf_b);
+
+  CHECK(create("a", 0), "create \"a\"");
+  CHECK(create("b", 0), "create \"b\"");
+
+  CHECK((fd_a = open("a")) > 1, "open \"a\"");
+  CHECK((fd_b = open("b")) > 1, "open \"b\"");
+
+  msg("write \"a\" and \"b\" alternately");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += 512) {
+    write_sector("a", fd_a, buf_a, ofs);
+    write_sector("b", fd_b, buf_b, ofs);
+  }
+
+  msg("close \"a\"");
+  close(fd_a);
+
+  msg("close \"b\"");
+  close(fd_b);
+
+  check_file("a", buf_a, FILE_SIZE);
+  check_file("b", buf_b, FILE_SIZE);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-fragmented) begin
+(grow-fragmented) create "a"
+(grow-fragmented) create "b"
+(grow-fragmented) open "a"
+(grow-fragmented) open "b"
+(grow-fragmented) write "a" and "b" alternately
+(grow-fragmented) close "a"
+(grow-fragmented) close "b"
+(grow-fragmented) open "a" for verification
+(grow-fragmented) verified contents of "a"
+(grow-fragmented) close "a"
+(grow-fragmented) open "b" for verification
+(grow-fragmented) verified contents of "b"
+(grow-fragmented) close "b"
+(grow-fragmented) end
+EOF
+pass;
@@ -0,0 +1,130 @@
+/* Test program for the scanning functions in lib/kernel/bitmap.c.
+
+   Checks bitmap_scan(), bitmap_contains() and
+   bitmap_scan_and_flip_next() against simple bit-at-a-time
+   versions, on bitmaps of many sizes filled at several densities,
+   for every start position and a range of group sizes.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+
+/* Largest bitmap tested, in bits.  Several elements long, so that
+   groups cross element boundaries. */
+#define MAX_BITS 100
+
+/* Largest group size tested. */
+#define MAX_CNT 40
+
+static void fill(struct bitmap*, int density);
+static size_t bit_scan(const struct bitmap*, size_t start, size_t cnt, bool);
+static bool bit_contains(const struct bitmap*, size_t start, size_t cnt, bool);
+static void verify_scan(struct bitmap*);
+static void verify_next(struct bitmap*);
+
+/* Tests the bitmap scanning functions. */
+void test(void) {
+  size_t bit_cnt;
+
+  printf("testing various size bitmaps:");
+  for (bit_cnt = 0; bit_cnt <= MAX_BITS; bit_cnt++) {
+    struct bitmap* b = bitmap_create(bit_cnt);
+    int density;
+
+    ASSERT(b != NULL);
+    if (bit_cnt % 10 == 0)
+      printf(" %zu", bit_cnt);
+    for (density = 0; density <= 100; density += 25) {
+      fill(b, density);
+      verify_scan(b);
+      verify_next(b);
+    }
+    bitmap_destroy(b);
+  }
+  printf(" done\n");
+  printf("bitmap: PASS\n");
+}
+
+/* Sets each bit in B with probability DENSITY percent. */
+static void fill(struct bitmap* b, int density) {
+  size_t i;
+
+  for (i = 0; i < bitmap_size(b); i++)
+    bitmap_set(b, i, (int)(random_ulong() % 100) < density);
+}
+
+/* Checks bitmap_scan() and bitmap_contains() on B for every start
+   position and group size. */
+static void verify_scan(struct bitmap* b) {
+  size_t start, cnt;
+  int value;
+
+  for (value = 0; value <= 1; value++)
+    for (start = 0; start <= bitmap_size(b); start++)
+      for (cnt = 0; cnt <= MAX_CNT && start + cnt <= bitmap_size(b); cnt++) {
+        ASSERT(bitmap_scan(b, start, cnt, value) == bit_scan(b, start, cnt, value));
+        ASSERT(bitmap_contains(b, start, cnt, value) == bit_contains(b, start, cnt, value));
+      }
+}
+
+/* Checks bitmap_scan_and_flip_next() on copies of B for every
+   hint and a range of group sizes.  The group found must be the
+   first one at or after the hint, or failing that the first one
+   before it, and the hint must end up just past it. */
+static void verify_next(struct bitmap* b) {
+  static unsigned long buf[256];
+  size_t hint, cnt;
+
+  ASSERT(bitmap_buf_size(bitmap_size(b)) <= sizeof buf);
+  for (hint = 0; hint <= bitmap_size(b); hint++)
+    for (cnt = 1; cnt <= MAX_CNT && cnt <= bitmap_size(b); cnt += 5) {
+      struct bitmap* copy = bitmap_create_in_buf(bitmap_size(b), buf, sizeof buf);
+      size_t expected, idx, new_hint = hint, i;
+
+      for (i = 0; i < bitmap_size(b); i++)
+        bitmap_set(copy, i, bitmap_test(b, i));
+
+      expected = bit_scan(b, hint, cnt, false);
+      if (expected == BITMAP_ERROR) {
+        expected = bit_scan(b, 0, cnt, false);
+        if (expected >= hint)
+          expected = BITMAP_ERROR;
+      }
+
+      idx = bitmap_scan_and_flip_next(copy, &new_hint, cnt, false);
+      ASSERT(idx == expected);
+      if (idx == BITMAP_ERROR) {
+        ASSERT(new_hint == hint);
+      } else {
+        ASSERT(new_hint == idx + cnt);
+        ASSERT(!bit_contains(copy, idx, cnt, false));
+      }
+    }
+}
+
+/* Bit-at-a-time bitmap_scan(), for reference. */
+static size_t bit_scan(const struct bitmap* b, size_t start, size_t cnt, bool value) {
+  size_t i;
+
+  for (i = start; i + cnt <= bitmap_size(b); i++)
+    if (!bit_contains(b, i, cnt, !value))
+      return i;
+  return BITMAP_ERROR;
+}
+
+/* Bit-at-a-time bitmap_contains(), for reference. */
+static bool bit_contains(const struct bitmap* b, size_t start, size_t cnt, bool value) {
+  size_t i;
+
+  for (i = start; i < start + cnt; i++)
+    if (bitmap_test(b, i) == value)
+      return true;
+  return false;
+}
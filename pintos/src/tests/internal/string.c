@@ -0,0 +1,157 @@
+/* Test program for the block functions in lib/string.c.
+
+   Checks memcpy(), memmove(), memset() and memcmp() against
+   simple byte-at-a-time versions over a range of sizes and
+   alignments, then compares their speed, in bytes per kilocycle
+   as measured by the time-stamp counter, for block sizes from 8
+   bytes to 4 kB.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Largest block size tested. */
+#define MAX_SIZE 4096
+
+/* Times each measurement is repeated. */
+#define REPEAT_CNT 64
+
+static uint8_t src[MAX_SIZE + 16];
+static uint8_t dst[MAX_SIZE + 16];
+static uint8_t ref[MAX_SIZE + 16];
+
+static void* byte_memcpy(void*, const void*, size_t);
+static void* byte_memset(void*, int, size_t);
+static int byte_memcmp(const void*, const void*, size_t);
+static void verify(void);
+static void benchmark(void);
+static uint64_t rdtsc(void);
+
+/* Tests the block functions. */
+void test(void) {
+  verify();
+  benchmark();
+  printf("string: PASS\n");
+}
+
+/* Checks the block functions against the byte-at-a-time versions
+   for every size up to 300 bytes and a few larger ones, at every
+   combination of source and destination alignment. */
+static void verify(void) {
+  static const size_t big_sizes[] = {511, 512, 513, 1024, 4095, MAX_SIZE};
+  size_t i;
+
+  for (i = 0; i < 300 + sizeof big_sizes / sizeof *big_sizes; i++) {
+    size_t size = i < 300 ? i : big_sizes[i - 300];
+    int src_ofs, dst_ofs;
+
+    for (src_ofs = 0; src_ofs < 4; src_ofs++)
+      for (dst_ofs = 0; dst_ofs < 4; dst_ofs++) {
+        random_bytes(src, sizeof src);
+        random_bytes(dst, sizeof dst);
+
+        memcpy(ref, dst, sizeof ref);
+        byte_memcpy(ref + dst_ofs, src + src_ofs, size);
+        ASSERT(memcpy(dst + dst_ofs, src + src_ofs, size) == dst + dst_ofs);
+        ASSERT(byte_memcmp(dst, ref, sizeof dst) == 0);
+        ASSERT(memcmp(dst, ref, sizeof dst) == 0);
+
+        byte_memset(ref + dst_ofs, src_ofs * 0x55, size);
+        ASSERT(memset(dst + dst_ofs, src_ofs * 0x55, size) == dst + dst_ofs);
+        ASSERT(byte_memcmp(dst, ref, sizeof dst) == 0);
+
+        /* Overlapping moves in both directions. */
+        memcpy(ref, src, sizeof ref);
+        ASSERT(memmove(src + dst_ofs + 4, src + src_ofs, size) == src + dst_ofs + 4);
+        ASSERT(memmove(src + src_ofs, src + dst_ofs + 4, size) == src + src_ofs);
+        ASSERT(byte_memcmp(src + src_ofs, ref + src_ofs, size) == 0);
+
+        if (size > 0) {
+          size_t ofs = random_ulong() % size;
+          memcpy(ref, src, sizeof ref);
+          ref[src_ofs + ofs] ^= 0x80;
+          ASSERT(memcmp(src + src_ofs, ref + src_ofs, size)
+                 == byte_memcmp(src + src_ofs, ref + src_ofs, size));
+        }
+      }
+  }
+}
+
+/* Prints the speed of the byte-at-a-time and the library versions
+   of memcpy() and memset() for power-of-2 sizes. */
+static void benchmark(void) {
+  size_t size;
+
+  printf("size   byte memcpy   memcpy   byte memset   memset  (bytes/kcycle)\n");
+  for (size = 8; size <= MAX_SIZE; size *= 2) {
+    uint64_t cycles[4] = {0, 0, 0, 0};
+    int i, j;
+
+    for (i = 0; i < REPEAT_CNT; i++) {
+      uint64_t start[5];
+
+      start[0] = rdtsc();
+      byte_memcpy(dst, src, size);
+      start[1] = rdtsc();
+      memcpy(dst, src, size);
+      start[2] = rdtsc();
+      byte_memset(dst, i, size);
+      start[3] = rdtsc();
+      memset(dst, i, size);
+      start[4] = rdtsc();
+
+      for (j = 0; j < 4; j++)
+        cycles[j] += start[j + 1] - start[j];
+    }
+
+    printf("%4zu", size);
+    for (j = 0; j < 4; j++)
+      printf(" %12llu", size * REPEAT_CNT * 1000ULL / (cycles[j] != 0 ? cycles[j] : 1));
+    printf("\n");
+  }
+}
+
+/* Byte-at-a-time memcpy(), for reference. */
+static void* byte_memcpy(void* dst_, const void* src_, size_t size) {
+  uint8_t* dst = dst_;
+  const uint8_t* src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+/* Byte-at-a-time memset(), for reference. */
+static void* byte_memset(void* dst_, int value, size_t size) {
+  uint8_t* dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+/* Byte-at-a-time memcmp(), for reference. */
+static int byte_memcmp(const void* a_, const void* b_, size_t size) {
+  const uint8_t* a = a_;
+  const uint8_t* b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+/* Returns the processor's time-stamp counter. */
+static uint64_t rdtsc(void) {
+  uint64_t tsc;
+  asm volatile("rdtsc" : "=A"(tsc));
+  return tsc;
+}
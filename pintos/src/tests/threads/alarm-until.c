@@ -0,0 +1,68 @@
+/* Creates 3 threads that each sleep until 5 absolute deadlines
+   with timer_sleep_until(), staggered by one tick between
+   threads.  Records when each thread woke up and verifies that
+   every thread woke exactly on its deadline, in deadline order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 3
+#define ITER_CNT 5
+
+/* A wakeup: which thread, and how many ticks after the start. */
+struct wakeup {
+  int id;
+  int64_t tick;
+};
+
+static int64_t start;
+static struct wakeup wakeups[THREAD_CNT * ITER_CNT];
+static int wakeup_cnt;
+
+static thread_func sleeper;
+
+void test_alarm_until(void) {
+  int ids[THREAD_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT(!thread_mlfqs);
+
+  msg("Creating %d threads to sleep until %d deadlines each.", THREAD_CNT, ITER_CNT);
+
+  start = timer_ticks() + 100;
+  for (i = 0; i < THREAD_CNT; i++) {
+    char name[16];
+    snprintf(name, sizeof name, "thread %d", i);
+    ids[i] = i;
+    thread_create(name, PRI_DEFAULT, sleeper, &ids[i]);
+  }
+
+  /* Wait long enough for all the threads to finish. */
+  timer_sleep_until(start + ITER_CNT * 10 + 100, 0);
+
+  for (i = 0; i < wakeup_cnt; i++)
+    msg("thread %d: woke up at tick %lld", wakeups[i].id, wakeups[i].tick);
+}
+
+/* Sleeper thread. */
+static void sleeper(void* id_) {
+  int id = *(int*)id_;
+  int i;
+
+  for (i = 1; i <= ITER_CNT; i++) {
+    enum intr_level old_level;
+
+    timer_sleep_until(start + i * 10 + id, 0);
+
+    old_level = intr_disable();
+    wakeups[wakeup_cnt].id = id;
+    wakeups[wakeup_cnt].tick = timer_ticks() - start;
+    wakeup_cnt++;
+    intr_set_level(old_level);
+  }
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-until) begin
+(alarm-until) Creating 3 threads to sleep until 5 deadlines each.
+(alarm-until) thread 0: woke up at tick 10
+(alarm-until) thread 1: woke up at tick 11
+(alarm-until) thread 2: woke up at tick 12
+(alarm-until) thread 0: woke up at tick 20
+(alarm-until) thread 1: woke up at tick 21
+(alarm-until) thread 2: woke up at tick 22
+(alarm-until) thread 0: woke up at tick 30
+(alarm-until) thread 1: woke up at tick 31
+(alarm-until) thread 2: woke up at tick 32
+(alarm-until) thread 0: woke up at tick 40
+(alarm-until) thread 1: woke up at tick 41
+(alarm-until) thread 2: woke up at tick 42
+(alarm-until) thread 0: woke up at tick 50
+(alarm-until) thread 1: woke up at tick 51
+(alarm-until) thread 2: woke up at tick 52
+(alarm-until) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Acquires and releases an uncontended lock many times, then has
+   a higher-priority thread wait for it.  Checks the lock's
+   acquire and contention counters, and that priority donation
+   still happens once the lock is contended.
+
+   The uncontended loop exercises the lock fast path.  The kernel
+   tick count reported at shutdown shows how much it costs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define ITER_CNT 100000
+
+static thread_func acquire_thread_func;
+
+void test_lock_fast(void) {
+  struct lock lock;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT(!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT(thread_get_priority() == PRI_DEFAULT);
+
+  lock_init(&lock);
+  msg("Acquiring and releasing a free lock %d times.", ITER_CNT);
+  for (i = 0; i < ITER_CNT; i++) {
+    lock_acquire(&lock);
+    lock_release(&lock);
+  }
+  msg("Lock acquired %llu times, contended %llu times.", lock.acquire_cnt, lock.contend_cnt);
+
+  lock_acquire(&lock);
+  thread_create("acquire", PRI_DEFAULT + 1, acquire_thread_func, &lock);
+  msg("This thread should have priority %d.  Actual priority: %d.", PRI_DEFAULT + 1,
+      thread_get_priority());
+  lock_release(&lock);
+  msg("Lock acquired %llu times, contended %llu times.", lock.acquire_cnt, lock.contend_cnt);
+}
+
+static void acquire_thread_func(void* lock_) {
+  struct lock* lock = lock_;
+
+  lock_acquire(lock);
+  msg("acquire: got the lock");
+  lock_release(lock);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lock-fast) begin
+(lock-fast) Acquiring and releasing a free lock 100000 times.
+(lock-fast) Lock acquired 100000 times, contended 0 times.
+(lock-fast) This thread should have priority 32.  Actual priority: 32.
+(lock-fast) acquire: got the lock
+(lock-fast) Lock acquired 100002 times, contended 1 times.
+(lock-fast) end
+EOF
+pass;
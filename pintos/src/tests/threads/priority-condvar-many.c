@@ -0,0 +1,77 @@
+/* Puts 256 threads, spread over 32 priorities, to sleep on one
+   condition variable, wakes them all with a single
+   cond_broadcast(), and checks that they reacquire the lock in
+   priority order, first come first served within a priority.
+
+   This stresses the condition and semaphore wait queues: the
+   broadcast and the following lock handoffs each pick the best of
+   hundreds of waiters.  The kernel tick count reported at
+   shutdown shows how much that costs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 256
+#define PRIORITY_CNT 32
+
+/* Waiters, numbered in the order they started waiting, in the
+   order they woke up. */
+static int woken[THREAD_CNT];
+static int woken_cnt;
+
+static int waiting_cnt;
+static struct lock lock;
+static struct condition condition;
+
+static thread_func waiter;
+
+void test_priority_condvar_many(void) {
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT(!thread_mlfqs);
+
+  lock_init(&lock);
+  cond_init(&condition);
+
+  /* Each waiter outranks us, so it runs and starts waiting as
+     soon as it is created. */
+  msg("Starting %d waiters at %d priorities.", THREAD_CNT, PRIORITY_CNT);
+  for (i = 0; i < THREAD_CNT; i++) {
+    char name[16];
+    snprintf(name, sizeof name, "waiter %d", i);
+    thread_create(name, PRI_DEFAULT + 1 + i % PRIORITY_CNT, waiter, NULL);
+  }
+  if (waiting_cnt != THREAD_CNT)
+    fail("only %d of %d waiters are waiting", waiting_cnt, THREAD_CNT);
+
+  msg("Broadcasting.");
+  lock_acquire(&lock);
+  cond_broadcast(&condition, &lock);
+  lock_release(&lock);
+
+  if (woken_cnt != THREAD_CNT)
+    fail("only %d of %d waiters woke up", woken_cnt, THREAD_CNT);
+  for (i = 1; i < THREAD_CNT; i++) {
+    int prev = woken[i - 1];
+    int cur = woken[i];
+    int prev_priority = prev % PRIORITY_CNT;
+    int cur_priority = cur % PRIORITY_CNT;
+    if (cur_priority > prev_priority || (cur_priority == prev_priority && cur < prev))
+      fail("waiter %d woke up after waiter %d", cur, prev);
+  }
+  msg("All waiters woke up in order.");
+}
+
+static void waiter(void* aux UNUSED) {
+  int id;
+
+  lock_acquire(&lock);
+  id = waiting_cnt++;
+  cond_wait(&condition, &lock);
+  woken[woken_cnt++] = id;
+  lock_release(&lock);
+}
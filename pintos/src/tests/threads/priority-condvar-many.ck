@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-condvar-many) begin
+(priority-condvar-many) Starting 256 waiters at 32 priorities.
+(priority-condvar-many) Broadcasting.
+(priority-condvar-many) All waiters woke up in order.
+(priority-condvar-many) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Checks that creating a thread preempts the creator only when
+   the new thread has a higher priority, and that
+   thread_create_many() creates all of its threads before any of
+   them runs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 4
+
+static tid_t tids[THREAD_CNT];
+
+static thread_func low_thread_func;
+static thread_func high_thread_func;
+
+void test_priority_create_many(void) {
+  void* aux[THREAD_CNT];
+  size_t created;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT(!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT(thread_get_priority() == PRI_DEFAULT);
+
+  thread_create("low", PRI_DEFAULT - 1, low_thread_func, NULL);
+  msg("Created low thread.");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    aux[i] = (void*)i;
+  created = thread_create_many("high", PRI_DEFAULT + 1, high_thread_func, aux, tids, THREAD_CNT);
+  msg("Created %zu high threads.", created);
+
+  thread_set_priority(PRI_MIN);
+  msg("Low thread should have run.");
+  thread_set_priority(PRI_DEFAULT);
+}
+
+static void low_thread_func(void* aux UNUSED) { msg("Low thread running."); }
+
+static void high_thread_func(void* id_) {
+  int id = (int)id_;
+  int tid_cnt = 0;
+  int i;
+
+  for (i = 0; i < THREAD_CNT; i++)
+    if (tids[i] != 0 && tids[i] != TID_ERROR)
+      tid_cnt++;
+  msg("High thread %d saw %d tids.", id, tid_cnt);
+}
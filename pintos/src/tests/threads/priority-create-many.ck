@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-create-many) begin
+(priority-create-many) Created low thread.
+(priority-create-many) High thread 0 saw 4 tids.
+(priority-create-many) High thread 1 saw 4 tids.
+(priority-create-many) High thread 2 saw 4 tids.
+(priority-create-many) High thread 3 saw 4 tids.
+(priority-create-many) Created 4 high threads.
+(priority-create-many) Low thread running.
+(priority-create-many) Low thread should have run.
+(priority-create-many) end
+EOF
+pass;
@@ -0,0 +1,60 @@
+/* The main thread holds a readers-writer lock for writing while a
+   reader and then a higher-priority writer wait for it.  Checks
+   that both donate their priority to the main thread, that the
+   donation ends when the main thread downgrades to read access,
+   and that the waiters get access in priority order. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void test_rwlock_donate(void) {
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT(!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT(thread_get_priority() == PRI_DEFAULT);
+
+  rwlock_init(&rwlock);
+  rwlock_acquire_write(&rwlock);
+
+  thread_create("reader", PRI_DEFAULT + 3, reader_thread_func, &rwlock);
+  msg("This thread should have priority %d.  Actual priority: %d.", PRI_DEFAULT + 3,
+      thread_get_priority());
+
+  thread_create("writer", PRI_DEFAULT + 6, writer_thread_func, &rwlock);
+  msg("This thread should have priority %d.  Actual priority: %d.", PRI_DEFAULT + 6,
+      thread_get_priority());
+
+  /* The writer takes over the wait for our read access to end, and
+     with it the donations. */
+  rwlock_downgrade(&rwlock);
+  msg("This thread should have priority %d.  Actual priority: %d.", PRI_DEFAULT,
+      thread_get_priority());
+
+  rwlock_release_read(&rwlock);
+  msg("Both waiters should have finished.");
+}
+
+static void reader_thread_func(void* rwlock_) {
+  struct rwlock* rwlock = rwlock_;
+
+  rwlock_acquire_read(rwlock);
+  msg("reader got read access.");
+  rwlock_release_read(rwlock);
+}
+
+static void writer_thread_func(void* rwlock_) {
+  struct rwlock* rwlock = rwlock_;
+
+  rwlock_acquire_write(rwlock);
+  msg("writer got write access.");
+  rwlock_release_write(rwlock);
+}
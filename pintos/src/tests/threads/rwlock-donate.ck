@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) This thread should have priority 34.  Actual priority: 34.
+(rwlock-donate) This thread should have priority 37.  Actual priority: 37.
+(rwlock-donate) This thread should have priority 31.  Actual priority: 31.
+(rwlock-donate) writer got write access.
+(rwlock-donate) reader got read access.
+(rwlock-donate) Both waiters should have finished.
+(rwlock-donate) end
+EOF
+pass;
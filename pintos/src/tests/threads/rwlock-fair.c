@@ -0,0 +1,59 @@
+/* Checks that readers share a readers-writer lock, that a waiting
+   writer holds off readers that arrive after it, and that a
+   lone reader can upgrade to writing without giving up access. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void test_rwlock_fair(void) {
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT(!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT(thread_get_priority() == PRI_DEFAULT);
+
+  rwlock_init(&rwlock);
+  rwlock_acquire_read(&rwlock);
+  msg("Main holds read access.");
+
+  /* Each of these outranks us, so it runs as soon as it is
+     created until it gets access or has to wait. */
+  thread_create("reader 1", PRI_DEFAULT + 1, reader_thread_func, &rwlock);
+  thread_create("writer", PRI_DEFAULT + 1, writer_thread_func, &rwlock);
+  thread_create("reader 2", PRI_DEFAULT + 1, reader_thread_func, &rwlock);
+
+  msg("Releasing read access.");
+  rwlock_release_read(&rwlock);
+
+  rwlock_acquire_read(&rwlock);
+  if (!rwlock_upgrade(&rwlock))
+    fail("upgrade without other users gave up read access");
+  if (!rwlock_held_for_write(&rwlock))
+    fail("upgrade did not grant write access");
+  rwlock_release_write(&rwlock);
+  msg("Upgraded read access to write access.");
+}
+
+static void reader_thread_func(void* rwlock_) {
+  struct rwlock* rwlock = rwlock_;
+
+  rwlock_acquire_read(rwlock);
+  msg("%s got read access.", thread_name());
+  rwlock_release_read(rwlock);
+}
+
+static void writer_thread_func(void* rwlock_) {
+  struct rwlock* rwlock = rwlock_;
+
+  rwlock_acquire_write(rwlock);
+  msg("%s got write access.", thread_name());
+  rwlock_release_write(rwlock);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-fair) begin
+(rwlock-fair) Main holds read access.
+(rwlock-fair) reader 1 got read access.
+(rwlock-fair) Releasing read access.
+(rwlock-fair) writer got write access.
+(rwlock-fair) reader 2 got read access.
+(rwlock-fair) Upgraded read access to write access.
+(rwlock-fair) end
+EOF
+pass;
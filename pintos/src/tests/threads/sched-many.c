@@ -0,0 +1,64 @@
+/* Creates 256 threads spread over every priority between PRI_MIN
+   and PRI_MAX, each of which yields many times, and checks that
+   they finish in priority order.
+
+   This stresses the scheduler: every yield puts the running thread
+   back on the ready queue and picks the next one with hundreds of
+   threads ready.  The kernel tick count reported at shutdown shows
+   how much that costs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+#define THREAD_CNT 256
+#define ITER_CNT 64
+
+/* Priorities of the threads, in the order they finished. */
+static int finished[THREAD_CNT];
+static int finish_cnt;
+
+static thread_func yielder;
+
+void test_sched_many(void) {
+  int priority_cnt = PRI_MAX - PRI_MIN - 1;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT(!thread_mlfqs);
+
+  msg("Creating %d threads at %d priorities.", THREAD_CNT, priority_cnt);
+  thread_set_priority(PRI_MAX);
+  for (i = 0; i < THREAD_CNT; i++) {
+    char name[16];
+    snprintf(name, sizeof name, "sched %d", i);
+    thread_create(name, PRI_MIN + 1 + i % priority_cnt, yielder, NULL);
+  }
+
+  /* Dropping below every thread lets them all run to completion
+     before we continue. */
+  msg("Letting them run.");
+  thread_set_priority(PRI_MIN);
+  thread_set_priority(PRI_DEFAULT);
+
+  if (finish_cnt != THREAD_CNT)
+    fail("only %d of %d threads finished", finish_cnt, THREAD_CNT);
+  for (i = 1; i < THREAD_CNT; i++)
+    if (finished[i] > finished[i - 1])
+      fail("priority %d thread finished after priority %d thread", finished[i], finished[i - 1]);
+  msg("All threads finished in priority order.");
+}
+
+static void yielder(void* aux UNUSED) {
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; i < ITER_CNT; i++)
+    thread_yield();
+
+  old_level = intr_disable();
+  finished[finish_cnt++] = thread_get_priority();
+  intr_set_level(old_level);
+}
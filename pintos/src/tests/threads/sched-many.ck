@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-many) begin
+(sched-many) Creating 256 threads at 62 priorities.
+(sched-many) Letting them run.
+(sched-many) All threads finished in priority order.
+(sched-many) end
+EOF
+pass;
@@ -15,6 +15,7 @@ static const struct test tests[] = {
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-until", test_alarm_until},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -27,6 +28,12 @@ static const struct test tests[] = {
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-condvar-many", test_priority_condvar_many},
+    {"lock-fast", test_lock_fast},
+    {"rwlock-fair", test_rwlock_fair},
+    {"rwlock-donate", test_rwlock_donate},
+    {"priority-create-many", test_priority_create_many},
+    {"sched-many", test_sched_many},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -0,0 +1,44 @@
+/* Maps the same file twice, reads both mappings so that they may
+   share memory, then writes through the first one.  Verifies that
+   the second mapping still sees the old data, and that a third
+   mapping made after the first is unmapped sees the new data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void test_main(void) {
+  static const char overwrite[] = "Now is the time for all good...";
+  char* actual[3] = {(char*)0x10000000, (char*)0x20000000, (char*)0x30000000};
+  mapid_t map[3];
+  size_t i;
+
+  for (i = 0; i < 2; i++) {
+    int handle;
+
+    CHECK((handle = open("sample.txt")) > 1, "open \"sample.txt\" #%zu", i);
+    CHECK((map[i] = mmap(handle, actual[i])) != MAP_FAILED, "mmap \"sample.txt\" #%zu", i);
+    CHECK(!memcmp(actual[i], sample, strlen(sample)), "compare mmap'd file %zu against data", i);
+  }
+
+  msg("write to mmap'd file 0");
+  memcpy(actual[0], overwrite, strlen(overwrite));
+  CHECK(!memcmp(actual[1], sample, strlen(sample)), "mmap'd file 1 is unchanged");
+
+  msg("munmap \"sample.txt\" #0");
+  munmap(map[0]);
+
+  {
+    int handle;
+
+    CHECK((handle = open("sample.txt")) > 1, "open \"sample.txt\" #2");
+    CHECK((map[2] = mmap(handle, actual[2])) != MAP_FAILED, "mmap \"sample.txt\" #2");
+  }
+  if (memcmp(actual[2], overwrite, strlen(overwrite)) ||
+      memcmp(actual[2] + strlen(overwrite), sample + strlen(overwrite),
+             strlen(sample) - strlen(overwrite)))
+    fail("mmap'd file 2 does not show the write");
+  msg("mmap'd file 2 shows the write");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-cow) begin
+(mmap-cow) open "sample.txt" #0
+(mmap-cow) mmap "sample.txt" #0
+(mmap-cow) compare mmap'd file 0 against data
+(mmap-cow) open "sample.txt" #1
+(mmap-cow) mmap "sample.txt" #1
+(mmap-cow) compare mmap'd file 1 against data
+(mmap-cow) write to mmap'd file 0
+(mmap-cow) mmap'd file 1 is unchanged
+(mmap-cow) munmap "sample.txt" #0
+(mmap-cow) open "sample.txt" #2
+(mmap-cow) mmap "sample.txt" #2
+(mmap-cow) mmap'd file 2 shows the write
+(mmap-cow) end
+EOF
+pass;
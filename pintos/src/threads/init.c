@@ -31,9 +31,15 @@
 #else
 #include "tests/threads/tests.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#endif
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -95,6 +101,9 @@ int main(void) {
   palloc_init(user_page_limit);
   malloc_init();
   paging_init();
+#ifdef VM
+  frame_init();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -123,6 +132,9 @@ int main(void) {
   locate_block_devices();
   filesys_init(format_filesys);
 #endif
+#ifdef VM
+  swap_init();
+#endif
 
   printf("Boot complete.\n");
 
@@ -232,9 +244,15 @@ static char** parse_options(char** argv) {
       filesys_bdev_name = value;
     else if (!strcmp(name, "-scratch"))
       scratch_bdev_name = value;
+    else if (!strcmp(name, "-cache"))
+      cache_configure(atoi(value));
+    else if (!strcmp(name, "-writeback"))
+      cache_configure_writeback(atoi(value));
 #ifdef VM
     else if (!strcmp(name, "-swap"))
       swap_bdev_name = value;
+    else if (!strcmp(name, "-stack"))
+      page_configure_stack(atoi(value) * 1024);
 #endif
 #endif
     else if (!strcmp(name, "-rs"))
@@ -294,6 +312,7 @@ static void run_actions(char** argv) {
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"blockbench", 1, fsutil_blockbench},
 #endif
       {NULL, 0, NULL},
   };
@@ -336,6 +355,7 @@ static void usage(void) {
          "  ls                 List files in the root directory.\n"
          "  cat FILE           Print FILE to the console.\n"
          "  rm FILE            Delete FILE.\n"
+         "  blockbench         Measure block device throughput in PIO and DMA modes.\n"
          "Use these actions indirectly via `pintos' -g and -p options:\n"
          "  extract            Untar from scratch device into file system.\n"
          "  append FILE        Append FILE to tar file on scratch device.\n"
@@ -348,8 +368,11 @@ static void usage(void) {
          "  -f                 Format file system device during startup.\n"
          "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
          "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+         "  -cache=COUNT       Cache COUNT disk sectors in memory.\n"
+         "  -writeback=MS      Write dirty cache blocks back every MS ms, 0 for never.\n"
 #ifdef VM
          "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+         "  -stack=KB          Let user stacks grow to KB kB.\n"
 #endif
 #endif
          "  -rs=SEED           Set random number seed to SEED.\n"
@@ -27,11 +27,158 @@
          */
 
 #include "threads/synch.h"
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Converts pointer to wait_elem ELEM into a pointer to the
+   structure that ELEM is embedded inside, as list_entry() does for
+   list elements. */
+#define wait_entry(ELEM, STRUCT, MEMBER) ((STRUCT*)((uint8_t*)(ELEM) - offsetof(STRUCT, MEMBER)))
+
+static void sema_wake(struct semaphore*);
+
+/* Initializes QUEUE as an empty wait queue. */
+void wait_queue_init(struct wait_queue* queue) {
+  ASSERT(queue != NULL);
+
+  queue->root = NULL;
+  queue->next_seq = 0;
+}
+
+/* Returns true if QUEUE has no waiters. */
+bool wait_queue_empty(const struct wait_queue* queue) { return queue->root == NULL; }
+
+/* Returns true if A should leave its queue before B: it has a
+   higher priority, or the same priority and arrived first. */
+static bool wait_before(const struct wait_elem* a, const struct wait_elem* b) {
+  if (a->priority != b->priority)
+    return a->priority > b->priority;
+  return (int)(a->seq - b->seq) < 0;
+}
+
+/* Melds the heaps rooted at A and B, either of which may be null,
+   and returns the root of the result. */
+static struct wait_elem* wait_meld(struct wait_elem* a, struct wait_elem* b) {
+  struct wait_elem* t;
+
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (wait_before(b, a)) {
+    t = a;
+    a = b;
+    b = t;
+  }
+
+  /* Make B the first child of A. */
+  b->prev = a;
+  b->sibling = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  return a;
+}
+
+/* Combines the list of sibling heaps starting at FIRST into a
+   single heap with the usual two-pass pairing and returns its
+   root. */
+static struct wait_elem* wait_merge_pairs(struct wait_elem* first) {
+  struct wait_elem* pairs = NULL;
+  struct wait_elem* root = NULL;
+
+  /* Meld siblings in pairs from left to right, stacking the
+     results on PAIRS. */
+  while (first != NULL) {
+    struct wait_elem* a = first;
+    struct wait_elem* b = a->sibling;
+
+    first = b != NULL ? b->sibling : NULL;
+    a->sibling = a->prev = NULL;
+    if (b != NULL)
+      b->sibling = b->prev = NULL;
+    a = wait_meld(a, b);
+    a->sibling = pairs;
+    pairs = a;
+  }
+
+  /* Meld the pairs together from right to left. */
+  while (pairs != NULL) {
+    struct wait_elem* next = pairs->sibling;
+    pairs->sibling = NULL;
+    root = wait_meld(root, pairs);
+    pairs = next;
+  }
+  return root;
+}
+
+/* Inserts ELEM, whose priority and seq are set, into QUEUE. */
+static void wait_link(struct wait_queue* queue, struct wait_elem* elem) {
+  elem->child = elem->sibling = elem->prev = NULL;
+  elem->queue = queue;
+  queue->root = wait_meld(queue->root, elem);
+}
+
+/* Removes ELEM from its queue. */
+static void wait_unlink(struct wait_elem* elem) {
+  struct wait_queue* queue = elem->queue;
+  struct wait_elem* rest = wait_merge_pairs(elem->child);
+
+  if (elem == queue->root)
+    queue->root = rest;
+  else {
+    if (elem->prev->child == elem)
+      elem->prev->child = elem->sibling;
+    else
+      elem->prev->sibling = elem->sibling;
+    if (elem->sibling != NULL)
+      elem->sibling->prev = elem->prev;
+    queue->root = wait_meld(queue->root, rest);
+  }
+  elem->queue = NULL;
+}
+
+/* Adds THREAD to QUEUE at THREAD's current priority, using ELEM
+   as its entry.  Interrupts must be off. */
+void wait_queue_push(struct wait_queue* queue, struct wait_elem* elem, struct thread* thread) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  elem->thread = thread;
+  elem->priority = thread->priority;
+  elem->seq = queue->next_seq++;
+  wait_link(queue, elem);
+}
+
+/* Removes and returns the highest-priority entry of QUEUE, which
+   must not be empty.  Interrupts must be off. */
+struct wait_elem* wait_queue_pop(struct wait_queue* queue) {
+  struct wait_elem* elem = queue->root;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(elem != NULL);
+
+  wait_unlink(elem);
+  return elem;
+}
+
+/* Moves ELEM, which must be on a queue, to the position for
+   PRIORITY.  It keeps its place among waiters of that priority
+   that arrived before and after it.  Interrupts must be off. */
+void wait_queue_reprioritize(struct wait_elem* elem, int priority) {
+  struct wait_queue* queue = elem->queue;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(queue != NULL);
+
+  wait_unlink(elem);
+  elem->priority = priority;
+  wait_link(queue, elem);
+}
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
                      nonnegative integer along with two atomic operators for
                      manipulating it:
@@ -45,7 +192,7 @@ void sema_init(struct semaphore* sema, unsigned value) {
   ASSERT(sema != NULL);
 
   sema->value = value;
-  list_init(&sema->waiters);
+  wait_queue_init(&sema->waiters);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -63,7 +210,7 @@ void sema_down(struct semaphore* sema) {
 
   old_level = intr_disable();
   while (sema->value == 0) {
-    list_insert_ordered(&sema->waiters, &thread_current()->elem, thread_compare_priority, NULL);
+    wait_queue_push(&sema->waiters, &thread_current()->wait_elem, thread_current());
     thread_block();
   }
   sema->value--;
@@ -101,17 +248,22 @@ void sema_up(struct semaphore* sema) {
   ASSERT(sema != NULL);
 
   old_level = intr_disable();
-  if (!list_empty(&sema->waiters)) {
-    list_sort(&sema->waiters, thread_compare_priority, NULL);
-    thread_unblock(list_entry(list_pop_front(&sema->waiters), struct thread, elem));
-  }
-
-  sema->value++;
+  sema_wake(sema);
 #ifndef USERPROG
   thread_yield();
 #endif
   intr_set_level(old_level);
 }
+
+/* Increments SEMA's value and unblocks its highest-priority
+   waiter, if any, without yielding.  Interrupts must be off. */
+static void sema_wake(struct semaphore* sema) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (!wait_queue_empty(&sema->waiters))
+    thread_unblock(wait_queue_pop(&sema->waiters)->thread);
+  sema->value++;
+}
 static void sema_test_helper(void* sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -162,6 +314,10 @@ void lock_init(struct lock* lock) {
   ASSERT(lock != NULL);
 
   lock->holder = NULL;
+  lock->max_priority = PRI_MIN;
+  lock->donating = false;
+  lock->acquire_cnt = 0;
+  lock->contend_cnt = 0;
   sema_init(&lock->semaphore, 1);
 }
 
@@ -172,10 +328,13 @@ void lock_init(struct lock* lock) {
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
-   we need to sleep. */
-void lock_acquire(struct lock* lock) {
+   we need to sleep.
 
-  struct thread* current_thread = thread_current();
+   A free lock is taken without any priority-donation
+   bookkeeping.  A lock joins its holder's list of donating locks
+   only once some thread has to wait for it. */
+void lock_acquire(struct lock* lock) {
+  struct thread* cur = thread_current();
   struct lock* l;
   enum intr_level old_level;
 
@@ -183,26 +342,46 @@ void lock_acquire(struct lock* lock) {
   ASSERT(!intr_context());
   ASSERT(!lock_held_by_current_thread(lock));
 
-  if (lock->holder != NULL && !thread_mlfqs) {
-    current_thread->waiting_lock = lock;
-    l = lock;
-    while (l && current_thread->priority > l->max_priority) {
-      l->max_priority = current_thread->priority;
+  old_level = intr_disable();
+  lock->acquire_cnt++;
+
+  /* Fast path: the lock is free. */
+  if (lock->semaphore.value > 0) {
+    lock->semaphore.value--;
+    lock->holder = cur;
+    intr_set_level(old_level);
+    return;
+  }
+
+  /* Slow path: donate our priority along the chain of holders,
+     starting to track each lock's donation on its holder the
+     first time it is contended. */
+  lock->contend_cnt++;
+  if (!thread_mlfqs) {
+    cur->waiting_lock = lock;
+    for (l = lock; l != NULL && l->holder != NULL; l = l->holder->waiting_lock) {
+      if (!l->donating) {
+        l->max_priority = PRI_MIN;
+        thread_hold_the_lock(l);
+      }
+      if (cur->priority <= l->max_priority)
+        break;
+      l->max_priority = cur->priority;
       thread_donate_priority(l->holder);
-      l = l->holder->waiting_lock;
     }
   }
 
   sema_down(&lock->semaphore);
-  old_level = intr_disable();
+  lock->holder = cur;
 
-  current_thread = thread_current();
+  /* Threads still waiting donate to us now. */
   if (!thread_mlfqs) {
-    current_thread->waiting_lock = NULL;
-    lock->max_priority = current_thread->priority;
-    thread_hold_the_lock(lock);
+    cur->waiting_lock = NULL;
+    if (!wait_queue_empty(&lock->semaphore.waiters)) {
+      lock->max_priority = lock->semaphore.waiters.root->priority;
+      thread_hold_the_lock(lock);
+    }
   }
-  lock->holder = current_thread;
 
   intr_set_level(old_level);
 }
@@ -214,14 +393,19 @@ void lock_acquire(struct lock* lock) {
    This function will not sleep, so it may be called within an
    interrupt handler. */
 bool lock_try_acquire(struct lock* lock) {
+  enum intr_level old_level;
   bool success;
 
   ASSERT(lock != NULL);
   ASSERT(!lock_held_by_current_thread(lock));
 
+  old_level = intr_disable();
   success = sema_try_down(&lock->semaphore);
-  if (success)
+  if (success) {
     lock->holder = thread_current();
+    lock->acquire_cnt++;
+  }
+  intr_set_level(old_level);
   return success;
 }
 
@@ -238,11 +422,15 @@ void lock_release(struct lock* lock) {
 
   old_level = intr_disable();
 
-  if (!thread_mlfqs)
+  if (lock->donating)
     thread_remove_lock(lock);
-
   lock->holder = NULL;
-  sema_up(&lock->semaphore);
+
+  /* Without waiters there is nobody to wake or yield to. */
+  if (wait_queue_empty(&lock->semaphore.waiters))
+    lock->semaphore.value++;
+  else
+    sema_up(&lock->semaphore);
 
   intr_set_level(old_level);
 }
@@ -256,9 +444,9 @@ bool lock_held_by_current_thread(const struct lock* lock) {
   return lock->holder == thread_current();
 }
 
-/* One semaphore in a list. */
+/* One semaphore in a condition's wait queue. */
 struct semaphore_elem {
-  struct list_elem elem;      /* List element. */
+  struct wait_elem elem;      /* Wait queue entry for the waiting thread. */
   struct semaphore semaphore; /* This semaphore. */
 };
 
@@ -268,7 +456,7 @@ struct semaphore_elem {
 void cond_init(struct condition* cond) {
   ASSERT(cond != NULL);
 
-  list_init(&cond->waiters);
+  wait_queue_init(&cond->waiters);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -292,17 +480,26 @@ void cond_init(struct condition* cond) {
    interrupts disabled, but interrupts will be turned back on if
    we need to sleep. */
 void cond_wait(struct condition* cond, struct lock* lock) {
+  struct thread* cur = thread_current();
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT(cond != NULL);
   ASSERT(lock != NULL);
   ASSERT(!intr_context());
   ASSERT(lock_held_by_current_thread(lock));
 
+  /* The queue entry is ordered by our priority, so it is exposed
+     through cond_elem for priority changes to reposition it. */
   sema_init(&waiter.semaphore, 0);
-  list_push_back(&cond->waiters, &waiter.elem);
+  old_level = intr_disable();
+  wait_queue_push(&cond->waiters, &waiter.elem, cur);
+  cur->cond_elem = &waiter.elem;
+  intr_set_level(old_level);
+
   lock_release(lock);
   sema_down(&waiter.semaphore);
+  cur->cond_elem = NULL;
   lock_acquire(lock);
 }
 
@@ -314,15 +511,17 @@ void cond_wait(struct condition* cond, struct lock* lock) {
    make sense to try to signal a condition variable within an
    interrupt handler. */
 void cond_signal(struct condition* cond, struct lock* lock UNUSED) {
+  enum intr_level old_level;
+
   ASSERT(cond != NULL);
   ASSERT(lock != NULL);
   ASSERT(!intr_context());
   ASSERT(lock_held_by_current_thread(lock));
 
-  if (!list_empty(&cond->waiters)) {
-    list_sort(&cond->waiters, cond_sema_cmp_priority, NULL);
-    sema_up(&list_entry(list_pop_front(&cond->waiters), struct semaphore_elem, elem)->semaphore);
-  }
+  old_level = intr_disable();
+  if (!wait_queue_empty(&cond->waiters))
+    sema_up(&wait_entry(wait_queue_pop(&cond->waiters), struct semaphore_elem, elem)->semaphore);
+  intr_set_level(old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -331,23 +530,172 @@ void cond_signal(struct condition* cond, struct lock* lock UNUSED) {
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
    interrupt handler. */
-void cond_broadcast(struct condition* cond, struct lock* lock) {
+void cond_broadcast(struct condition* cond, struct lock* lock UNUSED) {
+  enum intr_level old_level;
+
   ASSERT(cond != NULL);
   ASSERT(lock != NULL);
+  ASSERT(!intr_context());
+  ASSERT(lock_held_by_current_thread(lock));
+
+  /* Wake every waiter in priority order, then yield once, instead
+     of once per waiter as cond_signal() would. */
+  old_level = intr_disable();
+  if (!wait_queue_empty(&cond->waiters)) {
+    while (!wait_queue_empty(&cond->waiters)) {
+      struct wait_elem* e = wait_queue_pop(&cond->waiters);
+      sema_wake(&wait_entry(e, struct semaphore_elem, elem)->semaphore);
+    }
+#ifndef USERPROG
+    thread_yield();
+#endif
+  }
+  intr_set_level(old_level);
+}
+
+/* Initializes readers-writer lock RWLOCK.  Any number of threads
+   may hold it for reading at once, or one thread may hold it for
+   writing.
+
+   Writers are preferred: once a writer is waiting, threads that
+   newly ask for read access wait behind it.  Waiters are admitted
+   in priority order, first come first served within a priority.
+   A writer holds RWLOCK's inner lock for as long as it has write
+   access, so threads waiting for it donate their priority to it
+   through the usual lock donation.  Readers do not receive
+   donations, so read sections should be short. */
+void rwlock_init(struct rwlock* rwlock) {
+  ASSERT(rwlock != NULL);
+
+  lock_init(&rwlock->lock);
+  rwlock->writer = NULL;
+  rwlock->readers = 0;
+  rwlock->draining = false;
+  sema_init(&rwlock->drained, 0);
+}
+
+/* Acquires RWLOCK for reading, sleeping while a writer holds it or
+   is waiting for it.  RWLOCK must not already be held by the
+   current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_read(struct rwlock* rwlock) {
+  enum intr_level old_level;
+
+  ASSERT(rwlock != NULL);
+  ASSERT(!intr_context());
+
+  lock_acquire(&rwlock->lock);
+  old_level = intr_disable();
+  rwlock->readers++;
+  intr_set_level(old_level);
+  lock_release(&rwlock->lock);
+}
+
+/* Releases read access to RWLOCK, which the current thread must
+   hold.  Lets a waiting writer in if this was the last reader. */
+void rwlock_release_read(struct rwlock* rwlock) {
+  enum intr_level old_level;
+
+  ASSERT(rwlock != NULL);
+
+  old_level = intr_disable();
+  ASSERT(rwlock->readers > 0);
+  if (--rwlock->readers == 0 && rwlock->draining) {
+    rwlock->draining = false;
+    sema_up(&rwlock->drained);
+  }
+  intr_set_level(old_level);
+}
+
+/* Waits until every reader has left RWLOCK.  The current thread
+   must hold RWLOCK's inner lock. */
+static void rwlock_drain(struct rwlock* rwlock) {
+  enum intr_level old_level;
+
+  ASSERT(lock_held_by_current_thread(&rwlock->lock));
 
-  while (!list_empty(&cond->waiters))
-    cond_signal(cond, lock);
+  old_level = intr_disable();
+  if (rwlock->readers > 0) {
+    rwlock->draining = true;
+    sema_down(&rwlock->drained);
+  }
+  intr_set_level(old_level);
 }
 
-bool lock_cmp_priority(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED) {
-  return list_entry(a, struct lock, elem)->max_priority >
-         list_entry(b, struct lock, elem)->max_priority;
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it.  New readers are held off from the moment this thread
+   starts waiting for the current readers to leave.  RWLOCK must
+   not already be held by the current thread.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void rwlock_acquire_write(struct rwlock* rwlock) {
+  ASSERT(rwlock != NULL);
+  ASSERT(!intr_context());
+
+  lock_acquire(&rwlock->lock);
+  rwlock->writer = thread_current();
+  rwlock_drain(rwlock);
+}
+
+/* Releases write access to RWLOCK, which the current thread must
+   hold. */
+void rwlock_release_write(struct rwlock* rwlock) {
+  ASSERT(rwlock_held_for_write(rwlock));
+
+  rwlock->writer = NULL;
+  lock_release(&rwlock->lock);
+}
+
+/* Turns the current thread's read access to RWLOCK into write
+   access.  Returns true if no other writer got in between, so
+   that whatever the thread read is still valid.  Returns false if
+   another writer was already waiting: then the read access is
+   given up first, to avoid deadlock, and the caller must revalidate
+   what it read. */
+bool rwlock_upgrade(struct rwlock* rwlock) {
+  enum intr_level old_level;
+
+  ASSERT(rwlock != NULL);
+  ASSERT(!intr_context());
+
+  if (!lock_try_acquire(&rwlock->lock)) {
+    rwlock_release_read(rwlock);
+    rwlock_acquire_write(rwlock);
+    return false;
+  }
+
+  old_level = intr_disable();
+  ASSERT(rwlock->readers > 0);
+  rwlock->readers--;
+  intr_set_level(old_level);
+
+  rwlock->writer = thread_current();
+  rwlock_drain(rwlock);
+  return true;
+}
+
+/* Turns the current thread's write access to RWLOCK into read
+   access, without letting any writer in between. */
+void rwlock_downgrade(struct rwlock* rwlock) {
+  enum intr_level old_level;
+
+  ASSERT(rwlock_held_for_write(rwlock));
+
+  old_level = intr_disable();
+  rwlock->readers++;
+  intr_set_level(old_level);
+
+  rwlock->writer = NULL;
+  lock_release(&rwlock->lock);
+}
+
+/* Returns true if the current thread holds RWLOCK for writing,
+   false otherwise. */
+bool rwlock_held_for_write(const struct rwlock* rwlock) {
+  ASSERT(rwlock != NULL);
+
+  return rwlock->writer == thread_current();
 }
-/* cond sema comparation function */
-bool cond_sema_cmp_priority(const struct list_elem* a, const struct list_elem* b,
-                            void* aux UNUSED) {
-  struct semaphore_elem* sa = list_entry(a, struct semaphore_elem, elem);
-  struct semaphore_elem* sb = list_entry(b, struct semaphore_elem, elem);
-  return list_entry(list_front(&sa->semaphore.waiters), struct thread, elem)->priority >
-         list_entry(list_front(&sb->semaphore.waiters), struct thread, elem)->priority;
-}
\ No newline at end of file
@@ -4,10 +4,36 @@
 #include <list.h>
 #include <stdbool.h>
 
+/* A queue of waiting threads, ordered by priority and, among
+   threads of equal priority, by arrival.  It is a pairing heap,
+   so adding a waiter is O(1) and removing the highest-priority
+   waiter is O(log n) amortized.  Must be used with interrupts off. */
+struct wait_queue {
+  struct wait_elem* root; /* Highest-priority waiter. */
+  unsigned next_seq;      /* Arrival stamp for the next waiter. */
+};
+
+/* An entry in a wait_queue. */
+struct wait_elem {
+  struct wait_elem* child;   /* First child in the heap. */
+  struct wait_elem* sibling; /* Next sibling in the heap. */
+  struct wait_elem* prev;    /* Previous sibling, or parent if first child. */
+  struct wait_queue* queue;  /* Queue this entry is on, or null. */
+  struct thread* thread;     /* Waiting thread. */
+  int priority;              /* Priority the entry is ordered by. */
+  unsigned seq;              /* Arrival stamp. */
+};
+
+void wait_queue_init(struct wait_queue*);
+bool wait_queue_empty(const struct wait_queue*);
+void wait_queue_push(struct wait_queue*, struct wait_elem*, struct thread*);
+struct wait_elem* wait_queue_pop(struct wait_queue*);
+void wait_queue_reprioritize(struct wait_elem*, int priority);
+
 /* A counting semaphore. */
 struct semaphore {
-  unsigned value;      /* Current value. */
-  struct list waiters; /* List of waiting threads. */
+  unsigned value;            /* Current value. */
+  struct wait_queue waiters; /* Waiting threads. */
 };
 
 void sema_init(struct semaphore*, unsigned value);
@@ -20,8 +46,13 @@ void sema_self_test(void);
 struct lock {
   int max_priority;           /* Max priority of all threads aquiring this lock */
   struct list_elem elem;      /* Used in thread.c */
+  bool donating;              /* On the holder's list of donating locks? */
   struct thread* holder;      /* Thread holding lock (for debugging). */
   struct semaphore semaphore; /* Binary semaphore controlling access. */
+
+  /* Statistics. */
+  unsigned long long acquire_cnt; /* # of times the lock was acquired. */
+  unsigned long long contend_cnt; /* # of acquires that had to wait. */
 };
 
 void lock_init(struct lock*);
@@ -30,18 +61,34 @@ bool lock_try_acquire(struct lock*);
 void lock_release(struct lock*);
 bool lock_held_by_current_thread(const struct lock*);
 
-bool lock_cmp_priority(const struct list_elem* a, const struct list_elem* b, void* aux);
-
 /* Condition variable. */
 struct condition {
-  struct list waiters; /* List of waiting threads. */
+  struct wait_queue waiters; /* Waiting threads' semaphore_elems. */
 };
 
 void cond_init(struct condition*);
 void cond_wait(struct condition*, struct lock*);
 void cond_signal(struct condition*, struct lock*);
 void cond_broadcast(struct condition*, struct lock*);
-bool cond_sema_cmp_priority(const struct list_elem* a, const struct list_elem* b, void* aux);
+
+/* Readers-writer lock. */
+struct rwlock {
+  struct lock lock;         /* Held by the writer, and by readers entering. */
+  struct thread* writer;    /* Thread holding write access, if any. */
+  unsigned readers;         /* Number of threads holding read access. */
+  bool draining;            /* Writer waiting for readers to leave? */
+  struct semaphore drained; /* Upped when the last reader leaves. */
+};
+
+void rwlock_init(struct rwlock*);
+void rwlock_acquire_read(struct rwlock*);
+void rwlock_release_read(struct rwlock*);
+void rwlock_acquire_write(struct rwlock*);
+void rwlock_release_write(struct rwlock*);
+bool rwlock_upgrade(struct rwlock*);
+void rwlock_downgrade(struct rwlock*);
+bool rwlock_held_for_write(const struct rwlock*);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
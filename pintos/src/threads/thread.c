@@ -2,10 +2,12 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
 #include "threads/flags.h"
+#include "threads/loader.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
@@ -26,14 +28,42 @@ fixed_t load_avg;
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-            that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO queue
+   per priority, and bit P of ready_mask is set exactly when
+   ready_queues[P] is nonempty, so that picking the next thread and
+   making one ready both take constant time. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_mask;
+static size_t ready_cnt; /* Number of threads in the ready queues. */
+
+/* Threads whose recent_cpu or nice is nonzero, for the MLFQS.  The
+   once-a-second recent_cpu decay leaves every other thread's
+   recent_cpu, and so its priority, unchanged, so only these are
+   recomputed. */
+static struct list cpu_active_list;
 
 /* List of all processes.  Processes are added to this list
       when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Hash table of all threads keyed by tid, for thread_get().
+   Elements are threads' `tidelem' members.  Changed only with
+   interrupts off.  Until thread_start() sizes the real table, the
+   initial thread sits alone in tid_boot_bucket. */
+static struct list* tid_buckets;
+static size_t tid_bucket_cnt; /* Power of two. */
+static struct list tid_boot_bucket;
+
+/* Pages of exited threads, kept for reuse by thread_create() so
+   that spawning a thread usually skips the page allocator.  At
+   most THREAD_CACHE_MAX pages are kept; the rest go back to the
+   kernel pool.  Linked through the dead threads' `allelem'
+   members and changed only with interrupts off. */
+#define THREAD_CACHE_MAX 16
+static struct list thread_cache;
+static size_t thread_cache_cnt;
+
 /* Idle thread. */
 static struct thread* idle_thread;
 
@@ -43,9 +73,6 @@ static struct thread* initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
-//用于文件操作的全局锁
-static struct lock file_lock;
-
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame {
   void* eip;             /* Return address. */
@@ -78,6 +105,14 @@ static void* alloc_frame(struct thread*, size_t size);
 static void schedule(void);
 void thread_schedule_tail(struct thread* prev);
 static tid_t allocate_tid(void);
+static void ready_push(struct thread*);
+static void ready_remove(struct thread*);
+static void set_effective_priority(struct thread*, int priority);
+static tid_t spawn_thread(const char* name, int priority, thread_func*, void* aux,
+                          bool* preempt);
+static struct list* tid_bucket(tid_t);
+static struct thread* thread_page_alloc(void);
+static void thread_page_free(struct thread*);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
@@ -93,26 +128,66 @@ static tid_t allocate_tid(void);
    It is not safe to call thread_current() until this function
    finishes. */
 void thread_init(void) {
+  int i;
+
   ASSERT(intr_get_level() == INTR_OFF);
 
   lock_init(&tid_lock);
-  lock_init(&file_lock);
 
-  list_init(&ready_list);
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init(&ready_queues[i]);
+  ready_mask = 0;
+  ready_cnt = 0;
+  list_init(&cpu_active_list);
   list_init(&all_list);
+  list_init(&tid_boot_bucket);
+  tid_buckets = &tid_boot_bucket;
+  tid_bucket_cnt = 1;
+  list_init(&thread_cache);
+  thread_cache_cnt = 0;
+  load_avg = FP_CONST(0);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread();
   init_thread(initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid();
+  list_push_back(tid_bucket(initial_thread->tid), &initial_thread->tidelem);
+}
+
+/* Allocates the tid hash table and moves the initial thread into
+   it.  Every thread occupies a page of the kernel pool, which gets
+   about half of RAM, so one bucket per two pages of RAM keeps the
+   table's load factor at or below 1 however many threads run.
+   Tids are handed out in sequence, so live threads spread evenly
+   across the buckets. */
+static void tid_table_init(void) {
+  size_t cnt = 1, pages, i;
+
+  while (cnt < init_ram_pages / 2)
+    cnt *= 2;
+  pages = DIV_ROUND_UP(cnt * sizeof *tid_buckets, PGSIZE);
+
+  struct list* buckets = palloc_get_multiple(PAL_ASSERT, pages);
+  for (i = 0; i < cnt; i++)
+    list_init(&buckets[i]);
+
+  enum intr_level old_level = intr_disable();
+  list_remove(&initial_thread->tidelem);
+  tid_buckets = buckets;
+  tid_bucket_cnt = cnt;
+  list_push_back(tid_bucket(initial_thread->tid), &initial_thread->tidelem);
+  intr_set_level(old_level);
 }
 
 /* Starts preemptive thread scheduling by enabling interrupts.
    Also creates the idle thread. */
 void thread_start(void) {
-  /* Create the idle thread. */
   struct semaphore idle_started;
+
+  tid_table_init();
+
+  /* Create the idle thread. */
   sema_init(&idle_started, 0);
   thread_create("idle", PRI_MIN, idle, &idle_started);
 
@@ -161,35 +236,92 @@ void thread_print_stats(void) {
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   The caller is preempted only if the new thread has a higher
+   priority than the caller. */
 tid_t thread_create(const char* name, int priority, thread_func* function, void* aux) {
+  bool preempt;
+  tid_t tid;
+
+  tid = spawn_thread(name, priority, function, aux, &preempt);
+  if (preempt)
+    thread_yield();
+  return tid;
+}
+
+/* Creates CNT kernel threads named NAME with the given initial
+   PRIORITY.  Thread I executes FUNCTION passing AUX[I] as the
+   argument, and its identifier is stored into TIDS[I].  Stops at
+   the first thread that cannot be created and returns the number
+   of threads created.
+
+   Unlike CNT calls to thread_create(), the caller is preempted at
+   most once, after all the threads have been created, and only if
+   one of them has a higher priority than the caller. */
+size_t thread_create_many(const char* name, int priority, thread_func* function, void* aux[],
+                          tid_t tids[], size_t cnt) {
+  bool preempt = false;
+  size_t i;
+
+  for (i = 0; i < cnt; i++) {
+    bool outranks;
+
+    tids[i] = spawn_thread(name, priority, function, aux[i], &outranks);
+    if (tids[i] == TID_ERROR)
+      break;
+    preempt = preempt || outranks;
+  }
+  if (preempt)
+    thread_yield();
+  return i;
+}
+
+/* Creates a thread for thread_create() and adds it to the ready
+   queue without yielding.  Sets *PREEMPT to true if the new
+   thread outranks the running thread, false otherwise.  Returns
+   the new thread's identifier or TID_ERROR. */
+static tid_t spawn_thread(const char* name, int priority, thread_func* function, void* aux,
+                          bool* preempt) {
   struct thread* t;
   struct kernel_thread_frame* kf;
   struct switch_entry_frame* ef;
   struct switch_threads_frame* sf;
+  enum intr_level old_level;
   tid_t tid;
 
   ASSERT(function != NULL);
 
-#ifdef USERPROG
-  if (list_size(&all_list) >= 34) /* Maximum threads */
-    return TID_ERROR;
-#endif
+  *preempt = false;
 
-  /* Allocate thread. */
-  t = palloc_get_page(PAL_ZERO);
+  /* Allocate thread.  There is no fixed limit on the number of
+     threads: creation fails only when memory runs out. */
+  t = thread_page_alloc();
   if (t == NULL)
     return TID_ERROR;
 
-  /* Initialize thread. */
+#ifdef USERPROG
+  struct as_child_thread* as_child = malloc(sizeof(struct as_child_thread));
+  if (as_child == NULL) {
+    old_level = intr_disable();
+    thread_page_free(t);
+    intr_set_level(old_level);
+    return TID_ERROR;
+  }
+#endif
+
+  /* Initialize thread.  The MLFQS ignores PRIORITY, except for the
+     idle thread, which is created before idle_thread is set. */
   init_thread(t, name, priority);
   tid = t->tid = allocate_tid();
+  if (thread_mlfqs && idle_thread != NULL)
+    thread_mlfqs_update_priority(t);
+
+  old_level = intr_disable();
+  list_push_back(tid_bucket(tid), &t->tidelem);
+  intr_set_level(old_level);
 
 #ifdef USERPROG
   //初始化孩子元素
-  t->pointer_as_child_thread = malloc(sizeof(struct as_child_thread));
+  t->pointer_as_child_thread = as_child;
   t->pointer_as_child_thread->tid = tid;
   t->pointer_as_child_thread->exit_status = UINT32_MAX;
   t->pointer_as_child_thread->bewaited = false;
@@ -216,11 +348,11 @@ tid_t thread_create(const char* name, int priority, thread_func* function, void*
   sf->eip = switch_entry;
   sf->ebp = 0;
 
-  /* Add to run queue. */
+  /* Add to run queue.  Once unblocked, T may run and exit at any
+     time, so decide on preemption first. */
+  *preempt = t->priority > thread_current()->priority;
   thread_unblock(t);
 
-  thread_yield();
-
   return tid;
 }
 
@@ -253,8 +385,7 @@ void thread_unblock(struct thread* t) {
 
   old_level = intr_disable();
   ASSERT(t->status == THREAD_BLOCKED);
-  /* list_push_back (&ready_list, &t->elem); */
-  list_insert_ordered(&ready_list, &t->elem, (list_less_func*)&thread_compare_priority, NULL);
+  ready_push(t);
   t->status = THREAD_READY;
   intr_set_level(old_level);
 }
@@ -306,20 +437,20 @@ void thread_exit(int status) {
   while (!list_empty(files)) {
     e = list_pop_front(files);
     struct opened_file* f = list_entry(e, struct opened_file, file_elem);
-    acquire_file_lock();
     if (inode_is_dir(file_get_inode(f->file))) {
       dir_close((struct dir*)f->file);
     } else {
       file_close(f->file);
     }
-
-    release_file_lock();
     list_remove(e);
     free(f);
   }
 
 #endif
   list_remove(&thread_current()->allelem);
+  list_remove(&thread_current()->tidelem);
+  if (thread_current()->cpu_active)
+    list_remove(&thread_current()->cpu_elem);
 
 #ifdef USERPROG //信号量加上
   thread_current()->pointer_as_child_thread->exit_status = status;
@@ -340,7 +471,7 @@ void thread_yield(void) {
 
   old_level = intr_disable();
   if (cur != idle_thread)
-    list_insert_ordered(&ready_list, &cur->elem, (list_less_func*)&thread_compare_priority, NULL);
+    ready_push(cur);
   cur->status = THREAD_READY;
   schedule();
   intr_set_level(old_level);
@@ -373,7 +504,7 @@ void thread_set_priority(int new_priority) {
   cur->original_priority = new_priority;
 
   if (list_empty(&cur->locks) || new_priority > old_priority) {
-    cur->priority = new_priority;
+    set_effective_priority(cur, new_priority);
     thread_yield();
   }
   intr_set_level(old_level);
@@ -383,16 +514,15 @@ void thread_set_priority(int new_priority) {
 void thread_update_priority(struct thread* t) {
   enum intr_level old_level = intr_disable();
   int max_priority = t->original_priority;
-  int lock_priority;
+  struct list_elem* e;
 
-  if (!list_empty(&t->locks)) {
-    list_sort(&t->locks, lock_cmp_priority, NULL);
-    lock_priority = list_entry(list_front(&t->locks), struct lock, elem)->max_priority;
+  for (e = list_begin(&t->locks); e != list_end(&t->locks); e = list_next(e)) {
+    int lock_priority = list_entry(e, struct lock, elem)->max_priority;
     if (lock_priority > max_priority)
       max_priority = lock_priority;
   }
 
-  t->priority = max_priority;
+  set_effective_priority(t, max_priority);
   intr_set_level(old_level);
 }
 
@@ -476,9 +606,8 @@ static void init_thread(struct thread* t, const char* name, int priority) {
   list_init(&t->locks);
   t->waiting_lock = NULL;
   t->nice = 0;
-  load_avg = FP_CONST(0);
   t->magic = THREAD_MAGIC;
-  t->ticks_blocked = 0;
+  t->wakeup_tick = 0;
 
 #ifdef USERPROG
   t->dir = NULL;
@@ -488,6 +617,10 @@ static void init_thread(struct thread* t, const char* name, int priority) {
   t->exit_status = UINT32_MAX;
   t->executable = NULL;
   t->next_fd = 2;
+#ifdef VM
+  list_init(&t->mappings);
+  t->next_mapid = 0;
+#endif
 
   if (t == initial_thread)
     t->parent = NULL;
@@ -495,9 +628,42 @@ static void init_thread(struct thread* t, const char* name, int priority) {
     t->parent = thread_current();
 #endif
   old_level = intr_disable();
-  list_insert_ordered(&all_list, &t->allelem, (list_less_func*)&thread_compare_priority, NULL);
+  list_push_back(&all_list, &t->allelem);
+  intr_set_level(old_level);
+}
 
+/* Returns a page for a new thread, reusing an exited thread's
+   page if one is cached, or a null pointer if memory is exhausted.
+   The page is not zeroed; init_thread() clears `struct thread'
+   itself and the stack needs no initialization. */
+static struct thread* thread_page_alloc(void) {
+  struct thread* t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable();
+  if (!list_empty(&thread_cache)) {
+    t = list_entry(list_pop_front(&thread_cache), struct thread, allelem);
+    thread_cache_cnt--;
+  }
   intr_set_level(old_level);
+
+  if (t == NULL)
+    t = palloc_get_page(0);
+  return t;
+}
+
+/* Releases the page of thread T, which is no longer running,
+   caching it for thread_page_alloc() if there is room.  Interrupts
+   must be off. */
+static void thread_page_free(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (thread_cache_cnt < THREAD_CACHE_MAX) {
+    t->magic = 0;
+    list_push_front(&thread_cache, &t->allelem);
+    thread_cache_cnt++;
+  } else
+    palloc_free_page(t);
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
@@ -508,6 +674,7 @@ static void* alloc_frame(struct thread* t, size_t size) {
   ASSERT(size % sizeof(uint32_t) == 0);
 
   t->stack -= size;
+  memset(t->stack, 0, size);
   return t->stack;
 }
 
@@ -522,11 +689,61 @@ bool thread_compare_priority(const struct list_elem* a, const struct list_elem*
    will be in the run queue.)  If the run queue is empty, return
    idle_thread. */
 static struct thread* next_thread_to_run(void) {
-  if (list_empty(&ready_list))
+  uint32_t high = ready_mask >> 32;
+  uint32_t low = ready_mask;
+  int priority;
+  struct thread* t;
+
+  if (ready_mask == 0)
     return idle_thread;
-  else {
-    return list_entry(list_pop_front(&ready_list), struct thread, elem);
-  }
+
+  /* Highest set bit of the mask, without 64-bit libgcc helpers. */
+  priority = high != 0 ? 63 - __builtin_clz(high) : 31 - __builtin_clz(low);
+  t = list_entry(list_front(&ready_queues[priority]), struct thread, elem);
+  ready_remove(t);
+  return t;
+}
+
+/* Appends T to the ready queue for its priority.  Interrupts must be
+   off. */
+static void ready_push(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  list_push_back(&ready_queues[t->priority], &t->elem);
+  ready_mask |= (uint64_t)1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes T from its ready queue.  Interrupts must be off. */
+static void ready_remove(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  list_remove(&t->elem);
+  if (list_empty(&ready_queues[t->priority]))
+    ready_mask &= ~((uint64_t)1 << t->priority);
+  ready_cnt--;
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the back of
+   the matching ready queue if it is ready, and repositioning it in
+   any semaphore or condition wait queue it is on.  Interrupts must
+   be off. */
+static void set_effective_priority(struct thread* t, int priority) {
+  ASSERT(PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->priority == priority)
+    return;
+  if (t->status == THREAD_READY) {
+    ready_remove(t);
+    t->priority = priority;
+    ready_push(t);
+  } else
+    t->priority = priority;
+
+  if (t->wait_elem.queue != NULL)
+    wait_queue_reprioritize(&t->wait_elem, priority);
+  if (t->cond_elem != NULL && t->cond_elem->queue != NULL)
+    wait_queue_reprioritize(t->cond_elem, priority);
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -568,7 +785,7 @@ void thread_schedule_tail(struct thread* prev) {
      palloc().) */
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) {
     ASSERT(prev != cur);
-    palloc_free_page(prev);
+    thread_page_free(prev);
   }
 }
 
@@ -605,18 +822,23 @@ static tid_t allocate_tid(void) {
   return tid;
 }
 
-void acquire_file_lock() { lock_acquire(&file_lock); }
-
-void release_file_lock() { lock_release(&file_lock); }
+/* Returns the bucket of tid_buckets that holds the thread with
+   tid TID, if any. */
+static struct list* tid_bucket(tid_t tid) {
+  return &tid_buckets[(unsigned)tid & (tid_bucket_cnt - 1)];
+}
 
+/* Returns the live thread whose tid is TID, or a null pointer if
+   there is none. */
 struct thread* thread_get(tid_t tid) {
+  struct list* bucket = tid_bucket(tid);
   struct list_elem* e;
   struct thread* dest_thread = NULL;
   enum intr_level old_level;
 
   old_level = intr_disable();
-  for (e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)) {
-    struct thread* t = list_entry(e, struct thread, allelem);
+  for (e = list_begin(bucket); e != list_end(bucket); e = list_next(e)) {
+    struct thread* t = list_entry(e, struct thread, tidelem);
     if (tid == t->tid) {
       dest_thread = t;
       break;
@@ -625,29 +847,28 @@ struct thread* thread_get(tid_t tid) {
   intr_set_level(old_level);
   return dest_thread;
 }
-void blocked_thread_check(struct thread* t, void* aux UNUSED) {
-  if (t->status == THREAD_BLOCKED && t->ticks_blocked > 0) {
-    t->ticks_blocked--;
-    if (t->ticks_blocked == 0)
-      thread_unblock(t);
-  }
-}
-/* Let thread hold a lock */
+/* Puts LOCK, which has waiters, on its holder's list of locks
+   that donate priority, and applies LOCK's donation.  Locks nobody
+   waits for are never on the list, and the list is unordered,
+   since thread_update_priority() scans all of it anyway.
+   Interrupts must be off. */
 void thread_hold_the_lock(struct lock* lock) {
-  enum intr_level old_level = intr_disable();
-  list_insert_ordered(&thread_current()->locks, &lock->elem, lock_cmp_priority, NULL);
+  struct thread* holder = lock->holder;
 
-  if (lock->max_priority > thread_current()->priority) {
-    thread_current()->priority = lock->max_priority;
-    thread_yield();
-  }
+  ASSERT(intr_get_level() == INTR_OFF);
+  ASSERT(!lock->donating);
 
-  intr_set_level(old_level);
+  list_push_back(&holder->locks, &lock->elem);
+  lock->donating = true;
+  if (lock->max_priority > holder->priority)
+    set_effective_priority(holder, lock->max_priority);
 }
-/* Remove a lock. */
+/* Takes LOCK, which the current thread is releasing, off its list
+   of donating locks and drops LOCK's donation. */
 void thread_remove_lock(struct lock* lock) {
   enum intr_level old_level = intr_disable();
   list_remove(&lock->elem);
+  lock->donating = false;
   thread_update_priority(thread_current());
   intr_set_level(old_level);
 }
@@ -655,18 +876,26 @@ void thread_remove_lock(struct lock* lock) {
 void thread_donate_priority(struct thread* t) {
   enum intr_level old_level = intr_disable();
   thread_update_priority(t);
+  intr_set_level(old_level);
+}
 
-  /* Remove the old t and insert the new one in order */
-  if (t->status == THREAD_READY) {
-    list_remove(&t->elem);
-    list_insert_ordered(&ready_list, &t->elem, thread_compare_priority, NULL);
+/* Puts T on cpu_active_list if it is not there yet.  Interrupts must
+   be off. */
+static void mark_cpu_active(struct thread* t) {
+  ASSERT(intr_get_level() == INTR_OFF);
+
+  if (!t->cpu_active && t != idle_thread) {
+    list_push_back(&cpu_active_list, &t->cpu_elem);
+    t->cpu_active = true;
   }
-  intr_set_level(old_level);
 }
 
 /* Sets the current thread's nice value to NICE. */
 void thread_set_nice(int nice) {
+  enum intr_level old_level = intr_disable();
   thread_current()->nice = nice;
+  mark_cpu_active(thread_current());
+  intr_set_level(old_level);
   thread_mlfqs_update_priority(thread_current());
   thread_yield();
 }
@@ -682,10 +911,14 @@ void thread_mlfqs_update_priority(struct thread* t) {
   ASSERT(thread_mlfqs);
   ASSERT(t != idle_thread);
 
-  t->priority =
+  int priority =
       FP_INT_PART(FP_SUB_MIX(FP_SUB(FP_CONST(PRI_MAX), FP_DIV_MIX(t->recent_cpu, 4)), 2 * t->nice));
-  t->priority = t->priority < PRI_MIN ? PRI_MIN : t->priority;
-  t->priority = t->priority > PRI_MAX ? PRI_MAX : t->priority;
+  priority = priority < PRI_MIN ? PRI_MIN : priority;
+  priority = priority > PRI_MAX ? PRI_MAX : priority;
+
+  enum intr_level old_level = intr_disable();
+  set_effective_priority(t, priority);
+  intr_set_level(old_level);
 }
 
 /* Increase recent_cpu by 1. */
@@ -697,29 +930,33 @@ void thread_mlfqs_increase_recent_cpu_by_one(void) {
   if (current_thread == idle_thread)
     return;
   current_thread->recent_cpu = FP_ADD_MIX(current_thread->recent_cpu, 1);
+  mark_cpu_active(current_thread);
 }
 
-/* Every per second to refresh load_avg and recent_cpu of all threads. */
+/* Every per second to refresh load_avg, and recent_cpu and priority
+   of the threads on cpu_active_list.  Threads whose recent_cpu has
+   decayed to zero with a zero nice drop off the list. */
 void thread_mlfqs_update_load_avg_and_recent_cpu(void) {
   ASSERT(thread_mlfqs);
   ASSERT(intr_context());
 
-  size_t ready_threads = list_size(&ready_list);
+  size_t ready_threads = ready_cnt;
   if (thread_current() != idle_thread)
     ready_threads++;
   load_avg =
       FP_ADD(FP_DIV_MIX(FP_MULT_MIX(load_avg, 59), 60), FP_DIV_MIX(FP_CONST(ready_threads), 60));
 
-  struct thread* t;
-  struct list_elem* e = list_begin(&all_list);
-  for (; e != list_end(&all_list); e = list_next(e)) {
-    t = list_entry(e, struct thread, allelem);
-    if (t != idle_thread) {
-      t->recent_cpu = FP_ADD_MIX(
-          FP_MULT(FP_DIV(FP_MULT_MIX(load_avg, 2), FP_ADD_MIX(FP_MULT_MIX(load_avg, 2), 1)),
-                  t->recent_cpu),
-          t->nice);
-      thread_mlfqs_update_priority(t);
+  fixed_t decay = FP_DIV(FP_MULT_MIX(load_avg, 2), FP_ADD_MIX(FP_MULT_MIX(load_avg, 2), 1));
+  struct list_elem* e = list_begin(&cpu_active_list);
+  while (e != list_end(&cpu_active_list)) {
+    struct thread* t = list_entry(e, struct thread, cpu_elem);
+    e = list_next(e);
+
+    t->recent_cpu = FP_ADD_MIX(FP_MULT(decay, t->recent_cpu), t->nice);
+    thread_mlfqs_update_priority(t);
+    if (t->recent_cpu == 0 && t->nice == 0) {
+      list_remove(&t->cpu_elem);
+      t->cpu_active = false;
     }
   }
 }
@@ -2,6 +2,7 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
 #include "threads/synch.h"
@@ -105,9 +106,12 @@ struct thread {
   uint8_t* stack;            /* Saved stack pointer. */
   int priority;              /* Priority. */
   struct list_elem allelem;  /* List element for all threads list. */
+  struct list_elem tidelem;  /* List element in thread.c's tid hash. */
 
   /* Shared between thread.c and synch.c. */
-  struct list_elem elem; /* List element. */
+  struct list_elem elem;       /* List element. */
+  struct wait_elem wait_elem;  /* Entry in a semaphore's wait queue. */
+  struct wait_elem* cond_elem; /* Entry in a condition's wait queue, if waiting. */
 
 #ifdef USERPROG
   /* Owned by userprog/process.c. */
@@ -125,6 +129,15 @@ struct thread {
   struct list files;     //打开的文件
   struct semaphore exec_sema; //用于exec同步，只有当子进程load成功后，父进程才能从exec返回
   struct as_child_thread* pointer_as_child_thread;
+#ifdef VM
+  /* Owned by vm/page.c. */
+  struct hash* pages; /* Supplemental page table. */
+  void* user_esp;     /* User stack pointer on entry to a system call. */
+
+  /* Owned by userprog/process.c. */
+  struct list mappings; /* Memory-mapped files. */
+  int next_mapid;
+#endif
 #endif
   struct dir* dir;
   int exit_status; //退出状态
@@ -136,7 +149,9 @@ struct thread {
   int original_priority;
   int nice;
   int recent_cpu;
-  int64_t ticks_blocked;
+  bool cpu_active;           /* On thread.c's cpu_active_list? */
+  struct list_elem cpu_elem; /* Element in cpu_active_list. */
+  int64_t wakeup_tick; /* Tick to wake up at, owned by devices/timer.c. */
   unsigned magic; /* Detects stack overflow. */
 };
 
@@ -153,10 +168,11 @@ void thread_print_stats(void);
 
 typedef void thread_func(void* aux);
 tid_t thread_create(const char* name, int priority, thread_func*, void*);
+size_t thread_create_many(const char* name, int priority, thread_func*, void* aux[],
+                          tid_t tids[], size_t cnt);
 
 void thread_block(void);
 void thread_unblock(struct thread*);
-void blocked_thread_check(struct thread* t, void* aux UNUSED);
 struct thread* thread_current(void);
 tid_t thread_tid(void);
 const char* thread_name(void);
@@ -171,8 +187,6 @@ void thread_foreach(thread_action_func*, void*);
 bool thread_compare_priority(const struct list_elem* a, const struct list_elem* b,
                              void* aux UNUSED);
 
-/* Function for lock max priority comparison. */
-bool lock_cmp_priority(const struct list_elem* a, const struct list_elem* b, void* aux UNUSED);
 void thread_hold_the_lock(struct lock* lock);
 void thread_remove_lock(struct lock* lock);
 
@@ -190,9 +204,6 @@ void thread_update_priority(struct thread* t);
 /* Owned by userprog/process.c. */
 struct thread* thread_get(tid_t tid);
 bool thread_is_parent_of(tid_t tid);
-
-void acquire_file_lock(void);
-void release_file_lock(void);
 #endif
 void thread_mlfqs_increase_recent_cpu_by_one(void);
 void thread_mlfqs_update_load_avg_and_recent_cpu(void);
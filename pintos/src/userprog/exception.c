@@ -7,6 +7,9 @@
 /* My Implementation */
 #include "threads/vaddr.h"
 /* == My Implementation */
+#ifdef VM
+#include "vm/page.h"
+#endif
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
@@ -135,6 +138,15 @@ static void page_fault(struct intr_frame* f) {
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
+#ifdef VM
+  /* Bring in a page the process owns but has not touched yet, grow
+     the stack, or copy a shared page on the first write to it.  A
+     fault taken by the kernel inside a system call is judged against
+     the stack pointer the process entered the system call with. */
+  if ((not_present || write) && is_user_vaddr(fault_addr) &&
+      page_fault_in(fault_addr, user ? f->esp : thread_current()->user_esp, write))
+    return;
+#endif
   /* My Implementation */
   if (not_present || (is_kernel_vaddr(fault_addr) && user)) {
     thread_current()->exit_status = -1;
@@ -18,10 +18,25 @@
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
 
 static void extract_command_name(char* cmd_string, char* command_name);
 static void extract_command_args(char* cmd_string, char* argv[], int* argc);
 
+#ifdef VM
+/* A file mapped into memory by mmap(). */
+struct mapping {
+  mapid_t mapid;
+  struct file* file; /* Private handle, independent of the fd. */
+  uint8_t* base;     /* First mapped page. */
+  size_t page_cnt;   /* Number of mapped pages. */
+  struct list_elem elem;
+};
+#endif
+
 static thread_func start_process NO_RETURN;
 static bool load(const char* cmdline, void (**eip)(void), void** esp);
 
@@ -47,16 +62,13 @@ tid_t process_execute(const char* file_name) {
   extract_command_name(fn_copy, cmd_name);
 
   /* Create a new thread to execute FILE_NAME. */
-  acquire_file_lock();
   struct file* f = filesys_open(cmd_name); //检查是否存在
   if (f == NULL) {
-    release_file_lock();
     palloc_free_page(fn_copy);
     free(cmd_name);
     return TID_ERROR;
   }
   file_close(f);
-  release_file_lock();
   tid = thread_create(cmd_name, PRI_DEFAULT, start_process, fn_copy);
 
   struct thread* t = thread_get(tid);
@@ -162,6 +174,13 @@ void process_exit(int status) {
          directory before destroying the process's page
          directory, or our active page directory will be one
          that's been freed (and cleared). */
+#ifdef VM
+    while (!list_empty(&cur->mappings)) {
+      struct mapping* m = list_entry(list_front(&cur->mappings), struct mapping, elem);
+      process_munmap(m->mapid);
+    }
+    page_table_destroy();
+#endif
     cur->pagedir = NULL;
     pagedir_activate(NULL);
     pagedir_destroy(pd);
@@ -266,6 +285,10 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
   if (t->pagedir == NULL)
     goto done;
   process_activate();
+#ifdef VM
+  if (!page_table_create())
+    goto done;
+#endif
 
   char* fn_cp = malloc(strlen(file_name) + 1);
   strlcpy(fn_cp, file_name, strlen(file_name) + 1);
@@ -273,7 +296,6 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
   char *process_name, save_ptr;
   process_name = strtok_r(fn_cp, " ", &save_ptr);
 
-  acquire_file_lock();
   /* Open executable file. */
   file = filesys_open(process_name);
   if (file == NULL) {
@@ -362,13 +384,14 @@ bool load(const char* file_name, void (**eip)(void), void** esp) {
 
 done:
   /* We arrive here whether the load is successful or not. */
-  release_file_lock(); //此处不关闭，当线程结束后再关闭
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page(void* upage, void* kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -425,6 +448,9 @@ static bool validate_segment(const struct Elf32_Phdr* phdr, struct file* file) {
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With VM, the pages are only recorded in the supplemental page
+   table and are read in by the page fault handler on first touch.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t read_bytes,
@@ -433,6 +459,21 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
   ASSERT(pg_ofs(upage) == 0);
   ASSERT(ofs % PGSIZE == 0);
 
+#ifdef VM
+  while (read_bytes > 0 || zero_bytes > 0) {
+    size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+    size_t page_zero_bytes = PGSIZE - page_read_bytes;
+
+    if (!page_add_file(upage, file, ofs, page_read_bytes, writable))
+      return false;
+
+    read_bytes -= page_read_bytes;
+    zero_bytes -= page_zero_bytes;
+    ofs += page_read_bytes;
+    upage += PGSIZE;
+  }
+  return true;
+#else
   file_seek(file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) {
     /* Calculate how to fill this page.
@@ -465,15 +506,21 @@ static bool load_segment(struct file* file, off_t ofs, uint8_t* upage, uint32_t
     upage += PGSIZE;
   }
   return true;
+#endif
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
    user virtual memory. */
 static bool setup_stack(void** esp, char** argv, int argc) {
-  uint8_t* kpage;
   bool success = false;
 
-  kpage = palloc_get_page(PAL_USER | PAL_ZERO);
+#ifdef VM
+  uint8_t* upage = ((uint8_t*)PHYS_BASE) - PGSIZE;
+  success = page_add_zero(upage, true) && page_fault_in(upage, PHYS_BASE, true);
+  if (success)
+    *esp = PHYS_BASE;
+#else
+  uint8_t* kpage = palloc_get_page(PAL_USER | PAL_ZERO);
   if (kpage != NULL) {
     success = install_page(((uint8_t*)PHYS_BASE) - PGSIZE, kpage, true);
     if (success)
@@ -481,6 +528,7 @@ static bool setup_stack(void** esp, char** argv, int argc) {
     else
       palloc_free_page(kpage);
   }
+#endif
 
   if (success) {
 
@@ -519,6 +567,7 @@ static bool setup_stack(void** esp, char** argv, int argc) {
   return success;
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -536,6 +585,7 @@ static bool install_page(void* upage, void* kpage, bool writable) {
   return (pagedir_get_page(t->pagedir, upage) == NULL &&
           pagedir_set_page(t->pagedir, upage, kpage, writable));
 }
+#endif
 
 static void extract_command_name(char* cmd_string, char* command_name) {
   char* save_ptr;
@@ -578,9 +628,15 @@ int process_write(int fd, const void* buffer, unsigned size) {
   } else if (get_fd_entry(fd) != NULL) {
     if (inode_is_dir(file_get_inode(get_fd_entry(fd)->file)))
       return -1; // ADDED: cannot write to dir
-    acquire_file_lock();
-    int si = file_write(get_fd_entry(fd)->file, buffer, size);
-    release_file_lock();
+    struct file* file = get_fd_entry(fd)->file;
+#ifdef VM
+    off_t ofs = file_tell(file);
+#endif
+    int si = file_write(file, buffer, size);
+#ifdef VM
+    /* Mappers that page the file in later must see the new data. */
+    frame_share_drop(file_get_inode(file), ofs, si);
+#endif
     return si;
   }
   return -1;
@@ -591,36 +647,28 @@ int process_read(int fd, void* buffer, unsigned size) {
     //getbuf((char*)buffer, (size_t)size);
     return (int)size;
   } else if (get_fd_entry(fd) != NULL) {
-    acquire_file_lock();
     int si = file_read(get_fd_entry(fd)->file, buffer, size);
-    release_file_lock();
     return si;
   }
   return -1;
 }
 int process_isdir(int fd) {
   if (get_fd_entry(fd) != NULL) {
-    acquire_file_lock();
     int si = inode_is_dir(file_get_inode(get_fd_entry(fd)->file));
-    release_file_lock();
     return si;
   }
   return -1;
 }
 int process_inumber(int fd) {
   if (get_fd_entry(fd) != NULL) {
-    acquire_file_lock();
     int si = inode_get_inumber(file_get_inode(get_fd_entry(fd)->file));
-    release_file_lock();
     return si;
   }
   return false;
 }
 int process_readdir(int fd, char* name) {
   if (get_fd_entry(fd) != NULL) {
-    acquire_file_lock();
     bool si = dir_readdir((struct dir*)(get_fd_entry(fd)->file), name);
-    release_file_lock();
     return si;
   }
   return false;
@@ -628,9 +676,7 @@ int process_readdir(int fd, char* name) {
 static int allocate_fd(void) { return thread_current()->next_fd++; }
 
 int process_open(const char* file_name) {
-  acquire_file_lock();
   struct file* f = filesys_open(file_name);
-  release_file_lock();
   if (f == NULL)
     return -1;
   struct fd_entry* fd_entry = malloc(sizeof(struct fd_entry));
@@ -666,10 +712,76 @@ void process_seek(int fd, unsigned position) {
 void process_close(int fd) {
   struct fd_entry* fd_entry = get_fd_entry(fd);
   if (fd_entry != NULL) {
-    acquire_file_lock();
     file_close(fd_entry->file);
-    release_file_lock();
     list_remove(&fd_entry->elem);
     free(fd_entry);
   }
-}
\ No newline at end of file
+}
+
+#ifdef VM
+/* Maps the file open as FD at ADDR, page by page.  Nothing is read
+   until the pages are touched.  Fails if ADDR is null or not page
+   aligned, if the file is empty, or if any page of the range is
+   already in use. */
+mapid_t process_mmap(int fd, void* addr) {
+  struct fd_entry* fd_entry = get_fd_entry(fd);
+  struct mapping* m;
+  off_t length;
+  size_t i;
+
+  if (fd_entry == NULL || addr == NULL || pg_ofs(addr) != 0)
+    return -1;
+  length = file_length(fd_entry->file);
+  if (length == 0 || !is_user_vaddr((uint8_t*)addr + length - 1) ||
+      (uint8_t*)addr + length < (uint8_t*)addr)
+    return -1;
+
+  m = malloc(sizeof *m);
+  if (m == NULL)
+    return -1;
+  m->file = file_reopen(fd_entry->file);
+  if (m->file == NULL) {
+    free(m);
+    return -1;
+  }
+  m->base = addr;
+  m->page_cnt = DIV_ROUND_UP(length, PGSIZE);
+
+  for (i = 0; i < m->page_cnt; i++) {
+    off_t ofs = i * PGSIZE;
+    uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+
+    if (!page_add_mmap(m->base + ofs, m->file, ofs, read_bytes)) {
+      while (i-- > 0)
+        page_remove(m->base + i * PGSIZE);
+      file_close(m->file);
+      free(m);
+      return -1;
+    }
+  }
+
+  m->mapid = thread_current()->next_mapid++;
+  list_push_back(&thread_current()->mappings, &m->elem);
+  return m->mapid;
+}
+
+/* Unmaps MAPPING, writing modified pages back to the file. */
+void process_munmap(mapid_t mapping) {
+  struct list* mappings = &thread_current()->mappings;
+  struct list_elem* e;
+
+  for (e = list_begin(mappings); e != list_end(mappings); e = list_next(e)) {
+    struct mapping* m = list_entry(e, struct mapping, elem);
+    if (m->mapid == mapping) {
+      size_t i;
+
+      for (i = 0; i < m->page_cnt; i++)
+        page_remove(m->base + i * PGSIZE);
+      file_close(m->file);
+      list_remove(&m->elem);
+      free(m);
+      return;
+    }
+  }
+}
+#endif
@@ -25,4 +25,9 @@ int process_write(int fd, const void* buffer, unsigned length);
 void process_seek(int fd, unsigned position);
 int process_filesize(int fd);
 int process_tell(int fd);
+#ifdef VM
+typedef int mapid_t;
+mapid_t process_mmap(int fd, void* addr);
+void process_munmap(mapid_t mapping);
+#endif
 #endif /* userprog/process.h */
@@ -8,6 +8,9 @@
 #include "devices/shutdown.h"
 #include "userprog/process.h"
 #include "filesys/filesys.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 typedef int pid_t;
 static int (*syscall_handlers[20])(struct intr_frame*); /* Array of syscall functions */
@@ -66,6 +69,9 @@ static void syscall_handler(struct intr_frame* f UNUSED) {
    */
 
   /* printf("System call number: %d\n", args[0]); */
+#ifdef VM
+  thread_current()->user_esp = f->esp;
+#endif
   if (!is_valid_pointer(f->esp, 4)) {
     kill_program();
     return;
@@ -109,7 +115,14 @@ static int syscall_write(struct intr_frame* f) {
   unsigned size = *(unsigned*)(f->esp + 12);
   if (!is_valid_pointer(buffer, 1) || !is_valid_pointer(buffer + size, 1))
     return -1;
+#ifdef VM
+  if (!page_pin_range(buffer, size, false))
+    return -1;
+#endif
   int written_size = process_write(fd, buffer, size);
+#ifdef VM
+  page_unpin_range(buffer, size);
+#endif
   f->eax = written_size;
   return 0;
 }
@@ -124,7 +137,16 @@ static int syscall_read(struct intr_frame* f) {
 
   if (!is_valid_pointer(buffer, 1) || !is_valid_pointer(buffer + size, 1))
     return -1;
+#ifdef VM
+  /* Fault the buffer in and pin it up front: the file system must
+     not take a page fault while it holds a cache block. */
+  if (!page_pin_range(buffer, size, true))
+    return -1;
+#endif
   int _size = process_read(fd, buffer, size);
+#ifdef VM
+  page_unpin_range(buffer, size);
+#endif
   f->eax = _size;
   return 0;
 }
@@ -139,9 +161,7 @@ static int syscall_seek(struct intr_frame* f) {
 
   int fd = *(int*)(f->esp + 4);
   unsigned pos = *(unsigned*)(f->esp + 8);
-  acquire_file_lock();
   process_seek(fd, pos);
-  release_file_lock();
   return 0;
 }
 
@@ -150,9 +170,7 @@ static int syscall_tell(struct intr_frame* f) {
     return -1;
 
   int fd = *(int*)(f->esp + 4);
-  acquire_file_lock();
   f->eax = process_tell(fd);
-  release_file_lock();
   return 0;
 }
 static int syscall_wait(struct intr_frame* f) {
@@ -187,9 +205,7 @@ static int syscall_create(struct intr_frame* f) {
   }
   char* str = *(char**)(f->esp + 4);
   unsigned size = *(int*)(f->esp + 8);
-  acquire_file_lock();
   f->eax = filesys_create(str, size, false);
-  release_file_lock();
   return 0;
 }
 static int syscall_readdir(struct intr_frame* f) {
@@ -224,9 +240,7 @@ static int syscall_remove(struct intr_frame* f) {
   }
 
   char* str = *(char**)(f->esp + 4);
-  acquire_file_lock();
   f->eax = filesys_remove(str);
-  release_file_lock();
   return 0;
 }
 static int syscall_exec(struct intr_frame* f) {
@@ -252,9 +266,7 @@ static int syscall_filesize(struct intr_frame* f) {
   if (!is_valid_pointer(f->esp + 4, 4))
     return -1;
   int fd = *(int*)(f->esp + 4);
-  acquire_file_lock();
   f->eax = process_filesize(fd);
-  release_file_lock();
   return 0;
 }
 
@@ -262,20 +274,33 @@ static int syscall_mkdir(struct intr_frame* f) {
   if (!is_valid_pointer(f->esp + 4, 4) || !is_valid_string(*(char**)(f->esp + 4)))
     return -1;
   char* str = *(char**)(f->esp + 4);
-  acquire_file_lock();
   f->eax = filesys_create(str, 0, true);
-  release_file_lock();
   return 0;
 }
 static int syscall_chdir(struct intr_frame* f) {
   if (!is_valid_pointer(f->esp + 4, 4) || !is_valid_string(*(char**)(f->esp + 4)))
     return -1;
   char* str = *(char**)(f->esp + 4);
-  acquire_file_lock();
   f->eax = filesys_chdir(str);
-  release_file_lock();
   return 0;
 }
+#ifdef VM
+static int syscall_mmap(struct intr_frame* f) {
+  if (!is_valid_pointer(f->esp + 4, 8))
+    return -1;
+  int fd = *(int*)(f->esp + 4);
+  void* addr = *(void**)(f->esp + 8);
+  f->eax = process_mmap(fd, addr);
+  return 0;
+}
+static int syscall_munmap(struct intr_frame* f) {
+  if (!is_valid_pointer(f->esp + 4, 4))
+    return -1;
+  mapid_t mapping = *(int*)(f->esp + 4);
+  process_munmap(mapping);
+  return 0;
+}
+#endif
 void syscall_init(void) {
   intr_register_int(0x30, 3, INTR_ON, syscall_handler, "syscall");
   syscall_handlers[SYS_WRITE] = &syscall_write;
@@ -298,4 +323,8 @@ void syscall_init(void) {
   syscall_handlers[SYS_READDIR] = &syscall_readdir;
   syscall_handlers[SYS_ISDIR] = &syscall_isdir;
   syscall_handlers[SYS_INUMBER] = &syscall_inumber;
+#ifdef VM
+  syscall_handlers[SYS_MMAP] = &syscall_mmap;
+  syscall_handlers[SYS_MUNMAP] = &syscall_munmap;
+#endif
 }
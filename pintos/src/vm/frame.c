@@ -0,0 +1,368 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+
+/* Every frame currently handed out to a user page. */
+static struct list frames;
+
+/* Frames holding read-only file pages, keyed by contents. */
+static struct hash shared_frames;
+
+/* Guards FRAMES, SHARED_FRAMES, the page list and pin count of every
+   frame, and CLOCK_HAND. */
+static struct lock frame_lock;
+
+/* Next frame the clock algorithm will look at, or NULL to start
+   from the front of FRAMES. */
+static struct list_elem* clock_hand;
+
+/* Statistics. */
+static long long evict_cnt; /* Frames reclaimed by eviction. */
+static long long share_cnt; /* Page-ins satisfied by a shared frame. */
+static long long copy_cnt;  /* Shared frames copied on a write. */
+
+static unsigned frame_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct frame* f = hash_entry(e, struct frame, hash_elem);
+  return hash_bytes(&f->inode, sizeof f->inode) ^ hash_int(f->ofs);
+}
+
+static bool frame_less(const struct hash_elem* a_, const struct hash_elem* b_, void* aux UNUSED) {
+  const struct frame* a = hash_entry(a_, struct frame, hash_elem);
+  const struct frame* b = hash_entry(b_, struct frame, hash_elem);
+
+  if (a->inode != b->inode)
+    return a->inode < b->inode;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
+
+void frame_init(void) {
+  list_init(&frames);
+  hash_init(&shared_frames, frame_hash, frame_less, NULL);
+  lock_init(&frame_lock);
+  clock_hand = NULL;
+}
+
+/* Returns the frame under the clock hand and advances the hand.
+   FRAMES must not be empty. */
+static struct frame* clock_next(void) {
+  if (clock_hand == NULL || clock_hand == list_end(&frames))
+    clock_hand = list_begin(&frames);
+  struct frame* f = list_entry(clock_hand, struct frame, elem);
+  clock_hand = list_next(clock_hand);
+  return f;
+}
+
+/* Tries to acquire the lock of every page mapped to F without
+   blocking.  On failure, releases the ones taken and returns false. */
+static bool frame_trylock_pages(struct frame* f) {
+  struct list_elem* e;
+
+  for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e)) {
+    struct page* p = list_entry(e, struct page, frame_elem);
+
+    if (lock_held_by_current_thread(&p->lock) || !lock_try_acquire(&p->lock)) {
+      while (e != list_begin(&f->pages)) {
+        e = list_prev(e);
+        lock_release(&list_entry(e, struct page, frame_elem)->lock);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Releases the locks taken by frame_trylock_pages(). */
+static void frame_unlock_pages(struct frame* f) {
+  struct list_elem* e;
+
+  for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e))
+    lock_release(&list_entry(e, struct page, frame_elem)->lock);
+}
+
+/* Returns true if any page mapped to F was accessed since the last
+   call, clearing the accessed bits. */
+static bool frame_test_and_clear_accessed(struct frame* f) {
+  struct list_elem* e;
+  bool accessed = false;
+
+  for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e)) {
+    struct page* p = list_entry(e, struct page, frame_elem);
+    uint32_t* pd = p->owner->pagedir;
+
+    if (pagedir_is_accessed(pd, p->upage)) {
+      pagedir_set_accessed(pd, p->upage, false);
+      accessed = true;
+    }
+  }
+  return accessed;
+}
+
+/* Picks a victim with the clock algorithm, evicts every page mapped
+   to it and returns the frame, pinned and still in the frame table
+   but with no pages.  A frame whose accessed bit is set in any of
+   its mappings gets a second chance; pinned frames and frames with
+   a page locked by someone else are passed over.  Returns NULL if
+   no frame can be evicted. */
+static struct frame* frame_evict(void) {
+  size_t i, tries;
+
+  lock_acquire(&frame_lock);
+  /* Two full sweeps: the first may only clear accessed bits. */
+  tries = 2 * list_size(&frames);
+  for (i = 0; i < tries; i++) {
+    struct frame* f = clock_next();
+    struct list_elem* e;
+
+    if (!frame_trylock_pages(f))
+      continue;
+    if (f->pin_cnt > 0 || frame_test_and_clear_accessed(f)) {
+      frame_unlock_pages(f);
+      continue;
+    }
+
+    /* Do the I/O without the frame table lock.  The page locks keep
+       other evictors and the owners away meanwhile, and taking F
+       out of the sharing table keeps new sharers away. */
+    f->pin_cnt++;
+    if (f->inode != NULL) {
+      hash_delete(&shared_frames, &f->hash_elem);
+      f->inode = NULL;
+    }
+    lock_release(&frame_lock);
+
+    for (e = list_begin(&f->pages); e != list_end(&f->pages); e = list_next(e))
+      if (!page_evict(list_entry(e, struct page, frame_elem))) {
+        /* Only a private page can need swap space, so no other
+           page of F has been evicted. */
+        lock_acquire(&frame_lock);
+        f->pin_cnt--;
+        frame_unlock_pages(f);
+        lock_release(&frame_lock);
+        return NULL;
+      }
+
+    lock_acquire(&frame_lock);
+    while (!list_empty(&f->pages))
+      lock_release(&list_entry(list_pop_front(&f->pages), struct page, frame_elem)->lock);
+    evict_cnt++;
+    lock_release(&frame_lock);
+    return f;
+  }
+  lock_release(&frame_lock);
+  return NULL;
+}
+
+/* Returns a frame, zeroed if ZERO, that is in the frame table but
+   has no pages yet, pinned so that it cannot be evicted before the
+   caller attaches one.  Evicts another page if the user pool is
+   exhausted.  Returns NULL if no frame can be had. */
+static struct frame* frame_get(bool zero) {
+  struct frame* f;
+  void* kpage = palloc_get_page(PAL_USER | (zero ? PAL_ZERO : 0));
+
+  if (kpage == NULL) {
+    f = frame_evict();
+    if (f != NULL && zero)
+      memset(f->kpage, 0, PGSIZE);
+    return f;
+  }
+
+  f = malloc(sizeof *f);
+  if (f == NULL) {
+    palloc_free_page(kpage);
+    return NULL;
+  }
+  f->kpage = kpage;
+  list_init(&f->pages);
+  f->pin_cnt = 1;
+  f->inode = NULL;
+
+  lock_acquire(&frame_lock);
+  list_push_back(&frames, &f->elem);
+  lock_release(&frame_lock);
+  return f;
+}
+
+/* Attaches PAGE to F, which came from frame_get(), and unpins F.
+   Caller must hold frame_lock. */
+static void frame_attach(struct frame* f, struct page* page) {
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+
+  list_push_back(&f->pages, &page->frame_elem);
+  f->pin_cnt--;
+  page->frame = f;
+}
+
+/* Detaches PAGE from its frame F.  If that leaves F without pages,
+   takes F out of the frame table and returns true, and the caller
+   must free F with frame_free().  Caller must hold frame_lock. */
+static bool frame_detach(struct page* page) {
+  struct frame* f = page->frame;
+
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+
+  list_remove(&page->frame_elem);
+  page->frame = NULL;
+  if (!list_empty(&f->pages))
+    return false;
+
+  if (f->inode != NULL)
+    hash_delete(&shared_frames, &f->hash_elem);
+  if (clock_hand == &f->elem)
+    clock_hand = list_next(clock_hand);
+  list_remove(&f->elem);
+  return true;
+}
+
+/* Frees F, which frame_detach() took out of the frame table. */
+static void frame_free(struct frame* f) {
+  palloc_free_page(f->kpage);
+  free(f);
+}
+
+struct frame* frame_alloc(struct page* page, bool zero) {
+  struct frame* f = frame_get(zero);
+
+  if (f == NULL)
+    return NULL;
+  lock_acquire(&frame_lock);
+  frame_attach(f, page);
+  lock_release(&frame_lock);
+  return f;
+}
+
+void frame_release(struct page* page) {
+  struct frame* f = page->frame;
+  bool last;
+
+  ASSERT(lock_held_by_current_thread(&page->lock));
+
+  lock_acquire(&frame_lock);
+  last = frame_detach(page);
+  lock_release(&frame_lock);
+
+  if (last)
+    frame_free(f);
+}
+
+struct frame* frame_unshare(struct page* page) {
+  struct frame* old = page->frame;
+  struct frame* f;
+  bool last;
+
+  ASSERT(lock_held_by_current_thread(&page->lock));
+
+  lock_acquire(&frame_lock);
+  if (list_size(&old->pages) == 1) {
+    /* Nobody else maps OLD, so PAGE can keep it. */
+    if (old->inode != NULL) {
+      hash_delete(&shared_frames, &old->hash_elem);
+      old->inode = NULL;
+    }
+    lock_release(&frame_lock);
+    return old;
+  }
+  lock_release(&frame_lock);
+
+  /* PAGE stays on OLD's list, with its lock held, while the copy is
+     made, so OLD can be neither evicted nor freed meanwhile. */
+  f = frame_get(false);
+  if (f == NULL)
+    return NULL;
+  memcpy(f->kpage, old->kpage, PGSIZE);
+
+  lock_acquire(&frame_lock);
+  last = frame_detach(page);
+  frame_attach(f, page);
+  copy_cnt++;
+  lock_release(&frame_lock);
+
+  /* The other mappers may have let go of OLD during the copy. */
+  if (last)
+    frame_free(old);
+  return f;
+}
+
+struct frame* frame_share_lookup(struct page* page, struct inode* inode, off_t ofs,
+                                 uint32_t read_bytes) {
+  struct frame key;
+  struct hash_elem* e;
+  struct frame* f = NULL;
+
+  key.inode = inode;
+  key.ofs = ofs;
+  key.read_bytes = read_bytes;
+
+  lock_acquire(&frame_lock);
+  e = hash_find(&shared_frames, &key.hash_elem);
+  if (e != NULL) {
+    f = hash_entry(e, struct frame, hash_elem);
+    list_push_back(&f->pages, &page->frame_elem);
+    page->frame = f;
+    share_cnt++;
+  }
+  lock_release(&frame_lock);
+  return f;
+}
+
+void frame_share(struct frame* f, struct inode* inode, off_t ofs, uint32_t read_bytes) {
+  lock_acquire(&frame_lock);
+  f->inode = inode;
+  f->ofs = ofs;
+  f->read_bytes = read_bytes;
+  /* Someone may have loaded the same contents meanwhile; then F
+     stays private. */
+  if (hash_insert(&shared_frames, &f->hash_elem) != NULL)
+    f->inode = NULL;
+  lock_release(&frame_lock);
+}
+
+void frame_share_drop(struct inode* inode, off_t ofs, off_t size) {
+  struct hash_iterator i;
+  bool found;
+
+  lock_acquire(&frame_lock);
+  /* Deleting ends an iteration, so start over after each one. */
+  do {
+    found = false;
+    hash_first(&i, &shared_frames);
+    while (hash_next(&i)) {
+      struct frame* f = hash_entry(hash_cur(&i), struct frame, hash_elem);
+
+      if (f->inode == inode && f->ofs < ofs + size && ofs < f->ofs + (off_t)f->read_bytes) {
+        hash_delete(&shared_frames, &f->hash_elem);
+        f->inode = NULL;
+        found = true;
+        break;
+      }
+    }
+  } while (found);
+  lock_release(&frame_lock);
+}
+
+void frame_pin(struct frame* f) {
+  lock_acquire(&frame_lock);
+  f->pin_cnt++;
+  lock_release(&frame_lock);
+}
+
+void frame_unpin(struct frame* f) {
+  lock_acquire(&frame_lock);
+  ASSERT(f->pin_cnt > 0);
+  f->pin_cnt--;
+  lock_release(&frame_lock);
+}
+
+void frame_print_stats(void) {
+  printf("Frames: %lld evictions, %lld shared page-ins, %lld copies on write\n", evict_cnt,
+         share_cnt, copy_cnt);
+}
@@ -0,0 +1,73 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+#include "threads/thread.h"
+
+struct page;
+
+/* A physical frame from the user pool holding one user page.
+
+   A frame normally backs a single page.  A frame holding a
+   read-only page of an executable, or a page of a memory-mapped
+   file that has only been read, is entered in the sharing table
+   under (inode, offset, length).  Processes running the same
+   binary or mapping the same file map it instead of reading their
+   own copy. */
+struct frame {
+  void* kpage;           /* Kernel virtual address of the frame. */
+  struct list pages;     /* Pages mapped to this frame. */
+  int pin_cnt;           /* Must not be evicted while nonzero. */
+  struct list_elem elem; /* Element in the frame table. */
+
+  /* Sharing. */
+  struct inode* inode;        /* File the contents came from, or NULL if private. */
+  off_t ofs;                  /* Offset in INODE. */
+  uint32_t read_bytes;        /* Bytes read from INODE; the rest are zero. */
+  struct hash_elem hash_elem; /* Element in the sharing table. */
+};
+
+/* Initialize the frame table. */
+void frame_init(void);
+
+/* Allocate a frame for PAGE, zeroed if ZERO, and attach PAGE to it.
+   The caller must hold PAGE's lock.  When the user pool is
+   exhausted another page is evicted; returns NULL if none can be. */
+struct frame* frame_alloc(struct page* page, bool zero);
+
+/* Detach PAGE from its frame, freeing the frame if no other page
+   maps it.  The caller must hold PAGE's lock. */
+void frame_release(struct page* page);
+
+/* Attach PAGE to the shared frame holding READ_BYTES bytes of INODE
+   at OFS and return it, or return NULL if there is none. */
+struct frame* frame_share_lookup(struct page* page, struct inode* inode, off_t ofs,
+                                 uint32_t read_bytes);
+
+/* Enter FRAME, now filled with READ_BYTES bytes of INODE at OFS,
+   into the sharing table. */
+void frame_share(struct frame* frame, struct inode* inode, off_t ofs, uint32_t read_bytes);
+
+/* Take every frame holding bytes of INODE in [OFS, OFS + SIZE) out
+   of the sharing table, so that later page-ins read what was written
+   there.  Pages already mapped to those frames keep them. */
+void frame_share_drop(struct inode* inode, off_t ofs, off_t size);
+
+/* Give PAGE a frame of its own, with the contents of the possibly
+   shared frame it is attached to, and return it.  The caller must
+   hold PAGE's lock.  Returns NULL, leaving PAGE as it was, if no
+   frame is available. */
+struct frame* frame_unshare(struct page* page);
+
+/* Pin or unpin FRAME. */
+void frame_pin(struct frame* frame);
+void frame_unpin(struct frame* frame);
+
+/* Print frame table statistics. */
+void frame_print_stats(void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,334 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Largest size a user stack may grow to. */
+static size_t stack_limit = STACK_DEFAULT_LIMIT;
+
+void page_configure_stack(size_t limit) { stack_limit = limit; }
+
+static unsigned page_hash(const struct hash_elem* e, void* aux UNUSED) {
+  const struct page* p = hash_entry(e, struct page, hash_elem);
+  return hash_bytes(&p->upage, sizeof p->upage);
+}
+
+static bool page_less(const struct hash_elem* a, const struct hash_elem* b, void* aux UNUSED) {
+  return hash_entry(a, struct page, hash_elem)->upage <
+         hash_entry(b, struct page, hash_elem)->upage;
+}
+
+bool page_table_create(void) {
+  struct thread* t = thread_current();
+
+  t->pages = malloc(sizeof *t->pages);
+  if (t->pages == NULL)
+    return false;
+  if (!hash_init(t->pages, page_hash, page_less, NULL)) {
+    free(t->pages);
+    t->pages = NULL;
+    return false;
+  }
+  return true;
+}
+
+/* Writes the page in frame F back to P's file if P is a mapping
+   that has been modified through PD.  A frame still sharing the
+   old contents of that part of the file leaves the sharing table,
+   so that later mappers read what was written. */
+static void page_write_back(struct page* p, struct frame* f, uint32_t* pd) {
+  if (p->type == PAGE_MMAP && pagedir_is_dirty(pd, p->upage)) {
+    file_write_at(p->file, f->kpage, p->read_bytes, p->file_ofs);
+    frame_share_drop(file_get_inode(p->file), p->file_ofs, p->read_bytes);
+  }
+}
+
+/* Releases the frame or swap slot of P and frees P, which must
+   already be out of the page table. */
+static void page_free(struct page* p) {
+  uint32_t* pd = thread_current()->pagedir;
+
+  /* Wait out an eviction in progress. */
+  lock_acquire(&p->lock);
+  if (p->frame != NULL) {
+    pagedir_clear_page(pd, p->upage);
+    page_write_back(p, p->frame, pd);
+    frame_release(p);
+  } else if (p->type == PAGE_SWAP)
+    swap_free(p->swap_slot);
+  lock_release(&p->lock);
+  free(p);
+}
+
+static void page_destroy(struct hash_elem* e, void* aux UNUSED) {
+  page_free(hash_entry(e, struct page, hash_elem));
+}
+
+void page_table_destroy(void) {
+  struct thread* t = thread_current();
+
+  if (t->pages == NULL)
+    return;
+  hash_destroy(t->pages, page_destroy);
+  free(t->pages);
+  t->pages = NULL;
+}
+
+/* Returns the current process's page containing UADDR, or NULL. */
+static struct page* page_lookup(const void* uaddr) {
+  struct thread* t = thread_current();
+  struct page key;
+  struct hash_elem* e;
+
+  if (t->pages == NULL)
+    return NULL;
+  key.upage = pg_round_down(uaddr);
+  e = hash_find(t->pages, &key.hash_elem);
+  return e != NULL ? hash_entry(e, struct page, hash_elem) : NULL;
+}
+
+/* Adds a non-resident page at UPAGE of the given TYPE. */
+static struct page* page_add(void* upage, enum page_type type, bool writable) {
+  struct thread* t = thread_current();
+  struct page* p;
+
+  ASSERT(pg_ofs(upage) == 0);
+
+  p = malloc(sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->writable = writable;
+  p->type = type;
+  p->owner = t;
+  p->frame = NULL;
+  p->copy_on_write = false;
+  lock_init(&p->lock);
+  p->file = NULL;
+  p->file_ofs = 0;
+  p->read_bytes = 0;
+  p->swap_slot = SWAP_ERROR;
+
+  if (hash_insert(t->pages, &p->hash_elem) != NULL) {
+    free(p);
+    return NULL;
+  }
+  return p;
+}
+
+/* Adds a non-resident page at UPAGE that is read from FILE. */
+static bool page_add_backed(void* upage, enum page_type type, struct file* file, off_t ofs,
+                            uint32_t read_bytes, bool writable) {
+  struct page* p;
+
+  ASSERT(read_bytes <= PGSIZE);
+
+  p = page_add(upage, type, writable);
+  if (p == NULL)
+    return false;
+  p->file = file;
+  p->file_ofs = ofs;
+  p->read_bytes = read_bytes;
+  return true;
+}
+
+bool page_add_file(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                   bool writable) {
+  if (read_bytes == 0)
+    return page_add_zero(upage, writable);
+  return page_add_backed(upage, PAGE_FILE, file, ofs, read_bytes, writable);
+}
+
+bool page_add_zero(void* upage, bool writable) {
+  return page_add(upage, PAGE_ZERO, writable) != NULL;
+}
+
+bool page_add_mmap(void* upage, struct file* file, off_t ofs, uint32_t read_bytes) {
+  return page_add_backed(upage, PAGE_MMAP, file, ofs, read_bytes, true);
+}
+
+void page_remove(void* upage) {
+  struct page* p = page_lookup(upage);
+
+  if (p == NULL)
+    return;
+  hash_delete(thread_current()->pages, &p->hash_elem);
+  page_free(p);
+}
+
+/* Fills frame F with the contents of P. */
+static bool page_fill(struct page* p, struct frame* f) {
+  if (p->type == PAGE_SWAP) {
+    swap_in(p->swap_slot, f->kpage);
+    p->swap_slot = SWAP_ERROR;
+  } else if (p->type == PAGE_FILE || p->type == PAGE_MMAP) {
+    if (file_read_at(p->file, f->kpage, p->read_bytes, p->file_ofs) != (off_t)p->read_bytes)
+      return false;
+    memset((uint8_t*)f->kpage + p->read_bytes, 0, PGSIZE - p->read_bytes);
+  }
+  return true;
+}
+
+/* Gives P, which is mapped read-only to a frame it may share, a
+   private copy of the frame and maps the copy writable.  The caller
+   must hold P's lock. */
+static bool page_unshare(struct page* p) {
+  uint32_t* pd = p->owner->pagedir;
+  struct frame* f;
+
+  ASSERT(lock_held_by_current_thread(&p->lock));
+  ASSERT(p->copy_on_write);
+
+  /* Unmap first, so that nothing reaches the old frame through P
+     once P lets go of it. */
+  pagedir_clear_page(pd, p->upage);
+  f = frame_unshare(p);
+  if (f == NULL) {
+    pagedir_set_page(pd, p->upage, p->frame->kpage, false);
+    return false;
+  }
+  if (!pagedir_set_page(pd, p->upage, f->kpage, true)) {
+    frame_release(p);
+    return false;
+  }
+  p->copy_on_write = false;
+  return true;
+}
+
+/* Gives P a frame, fills it and maps it into the current process,
+   or, if WRITE and P is mapped copy-on-write, gives P its own copy.
+   A read-only executable page reuses the frame of another process
+   running the same binary when there is one.  So does a page of a
+   mapped file brought in by a read: it is mapped read-only, and
+   the first write to it copies it. */
+static bool page_in(struct page* p, bool write) {
+  bool shareable = (p->type == PAGE_FILE && !p->writable) || (p->type == PAGE_MMAP && !write);
+  struct inode* inode = shareable ? file_get_inode(p->file) : NULL;
+  struct frame* f = NULL;
+
+  ASSERT(lock_held_by_current_thread(&p->lock));
+
+  if (p->frame != NULL)
+    return write && p->copy_on_write ? page_unshare(p) : true;
+
+  if (shareable)
+    f = frame_share_lookup(p, inode, p->file_ofs, p->read_bytes);
+  if (f == NULL) {
+    f = frame_alloc(p, p->type == PAGE_ZERO);
+    if (f == NULL)
+      return false;
+    if (!page_fill(p, f)) {
+      frame_release(p);
+      return false;
+    }
+    if (shareable)
+      frame_share(f, inode, p->file_ofs, p->read_bytes);
+  }
+
+  p->copy_on_write = p->type == PAGE_MMAP && shareable;
+  if (!pagedir_set_page(p->owner->pagedir, p->upage, f->kpage,
+                        p->writable && !p->copy_on_write)) {
+    frame_release(p);
+    return false;
+  }
+  return true;
+}
+
+/* Returns true if an access to UADDR with the stack pointer at ESP
+   should grow the stack.  PUSHA checks access up to 32 bytes below
+   the stack pointer before moving it. */
+static bool is_stack_access(const void* uaddr, const void* esp) {
+  const uint8_t* addr = uaddr;
+  return addr < (uint8_t*)PHYS_BASE && addr >= (uint8_t*)PHYS_BASE - stack_limit &&
+         addr + 32 >= (const uint8_t*)esp;
+}
+
+/* Returns the current process's page containing UADDR, first adding
+   a stack page for it if the access is a stack access from ESP. */
+static struct page* page_lookup_or_grow(const void* uaddr, const void* esp) {
+  struct page* p = page_lookup(uaddr);
+
+  if (p == NULL && thread_current()->pages != NULL && is_stack_access(uaddr, esp))
+    p = page_add(pg_round_down(uaddr), PAGE_ZERO, true);
+  return p;
+}
+
+bool page_fault_in(const void* uaddr, const void* esp, bool write) {
+  struct page* p = page_lookup_or_grow(uaddr, esp);
+  bool success;
+
+  if (p == NULL || (write && !p->writable))
+    return false;
+  lock_acquire(&p->lock);
+  success = page_in(p, write);
+  lock_release(&p->lock);
+  return success;
+}
+
+bool page_pin_range(const void* buffer, size_t size, bool write) {
+  const uint8_t* upage;
+  const uint8_t* end = (const uint8_t*)buffer + size;
+
+  for (upage = pg_round_down(buffer); upage < end; upage += PGSIZE) {
+    const void* uaddr = upage > (const uint8_t*)buffer ? upage : buffer;
+    struct page* p = page_lookup_or_grow(uaddr, thread_current()->user_esp);
+    bool success = false;
+
+    if (p != NULL && (!write || p->writable)) {
+      lock_acquire(&p->lock);
+      success = page_in(p, write);
+      if (success)
+        frame_pin(p->frame);
+      lock_release(&p->lock);
+    }
+    if (!success) {
+      if (upage > (const uint8_t*)buffer)
+        page_unpin_range(buffer, upage - (const uint8_t*)buffer);
+      return false;
+    }
+  }
+  return true;
+}
+
+void page_unpin_range(const void* buffer, size_t size) {
+  const uint8_t* upage;
+  const uint8_t* end = (const uint8_t*)buffer + size;
+
+  for (upage = pg_round_down(buffer); upage < end; upage += PGSIZE) {
+    struct page* p = page_lookup(upage);
+
+    lock_acquire(&p->lock);
+    frame_unpin(p->frame);
+    lock_release(&p->lock);
+  }
+}
+
+bool page_evict(struct page* p) {
+  struct frame* f = p->frame;
+  uint32_t* pd = p->owner->pagedir;
+
+  ASSERT(lock_held_by_current_thread(&p->lock));
+
+  /* Unmap first, so the owner cannot dirty the page while it is
+     being written out. */
+  pagedir_clear_page(pd, p->upage);
+  if (p->type == PAGE_MMAP)
+    page_write_back(p, f, pd);
+  else if (p->type == PAGE_SWAP || pagedir_is_dirty(pd, p->upage)) {
+    size_t slot = swap_out(f->kpage);
+    if (slot == SWAP_ERROR) {
+      pagedir_set_page(pd, p->upage, f->kpage, p->writable);
+      pagedir_set_dirty(pd, p->upage, true);
+      return false;
+    }
+    p->type = PAGE_SWAP;
+    p->swap_slot = slot;
+  }
+  p->frame = NULL;
+  return true;
+}
@@ -0,0 +1,93 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/file.h"
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+/* Size user stacks may grow to unless overridden with -stack. */
+#define STACK_DEFAULT_LIMIT (8 * 1024 * 1024)
+
+/* Where the contents of a non-resident page come from. */
+enum page_type {
+  PAGE_ZERO, /* Zero-filled on first touch. */
+  PAGE_FILE, /* Read from FILE, then zero-filled. */
+  PAGE_SWAP, /* Modified; kept in swap while not resident. */
+  PAGE_MMAP  /* Mapped from FILE; written back to it when dirty. */
+};
+
+/* Supplemental page table entry: one user virtual page of a process. */
+struct page {
+  void* upage;                 /* User virtual address, page-aligned. */
+  bool writable;               /* May the process write to it? */
+  enum page_type type;         /* How to fill the page on first touch. */
+  struct thread* owner;        /* Process the page belongs to. */
+  struct frame* frame;         /* Frame holding the page, or NULL. */
+  struct list_elem frame_elem; /* Element in FRAME's page list. */
+  struct lock lock;            /* Serializes paging this page in and out. */
+  bool copy_on_write;          /* Mapped read-only to a frame it may share
+                                  until the first write copies it. */
+
+  /* PAGE_FILE and PAGE_MMAP only. */
+  struct file* file;   /* File to read from. */
+  off_t file_ofs;      /* Offset in FILE. */
+  uint32_t read_bytes; /* Bytes to read; the rest of the page is zeroed. */
+
+  /* PAGE_SWAP only. */
+  size_t swap_slot; /* Slot holding the page, or SWAP_ERROR if resident. */
+
+  struct hash_elem hash_elem; /* Element in the process's page table. */
+};
+
+/* Set the largest size, in bytes, a user stack may grow to. */
+void page_configure_stack(size_t limit);
+
+/* Create and destroy the current process's supplemental page table. */
+bool page_table_create(void);
+void page_table_destroy(void);
+
+/* Register UPAGE in the current process, filled from READ_BYTES
+   bytes of FILE at OFS on first touch.  Fails if UPAGE is taken. */
+bool page_add_file(void* upage, struct file* file, off_t ofs, uint32_t read_bytes,
+                   bool writable);
+
+/* Register UPAGE in the current process as a zero page.  Fails if
+   UPAGE is taken. */
+bool page_add_zero(void* upage, bool writable);
+
+/* Register UPAGE in the current process as a writable mapping of
+   READ_BYTES bytes of FILE at OFS.  Fails if UPAGE is taken. */
+bool page_add_mmap(void* upage, struct file* file, off_t ofs, uint32_t read_bytes);
+
+/* Remove UPAGE from the current process, writing it back to its
+   file first if it is a dirty mapping. */
+void page_remove(void* upage);
+
+/* Bring in the page containing UADDR, or, if WRITE, make sure it
+   is mapped writable, copying it if it was shared copy-on-write.
+   An unmapped UADDR that looks like a stack access from user stack
+   pointer ESP gets a new stack page.  Returns false if UADDR is not
+   part of the process, is read-only while WRITE is true, or no
+   frame is available. */
+bool page_fault_in(const void* uaddr, const void* esp, bool write);
+
+/* Bring in and pin every page covering SIZE bytes at BUFFER, so
+   that the kernel can access it without faulting.  The stack grows
+   as in page_fault_in(), judged against the user stack pointer saved
+   on entry to the system call.  Returns false, with nothing pinned,
+   if any of the pages is unmapped, or read-only while WRITE is
+   true. */
+bool page_pin_range(const void* buffer, size_t size, bool write);
+
+/* Undo page_pin_range(). */
+void page_unpin_range(const void* buffer, size_t size);
+
+/* Unmap P from its owner and save its contents if they cannot be
+   recreated.  Called by the frame table with P's lock held.
+   Returns false if P must be saved but swap is full. */
+bool page_evict(struct page* p);
+
+#endif /* vm/page.h */
@@ -0,0 +1,50 @@
+#include "vm/swap.h"
+#include <debug.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Sectors in one page-sized swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block* swap_device;
+static struct bitmap* swap_slots; /* Set bits are slots in use. */
+static struct lock swap_lock;
+
+void swap_init(void) {
+  lock_init(&swap_lock);
+  swap_device = block_get_role(BLOCK_SWAP);
+  if (swap_device == NULL)
+    return;
+
+  swap_slots = bitmap_create(block_size(swap_device) / SECTORS_PER_SLOT);
+  if (swap_slots == NULL)
+    PANIC("swap: bitmap creation failed");
+}
+
+size_t swap_out(const void* kpage) {
+  size_t slot;
+
+  if (swap_device == NULL)
+    return SWAP_ERROR;
+
+  lock_acquire(&swap_lock);
+  slot = bitmap_scan_and_flip(swap_slots, 0, 1, false);
+  lock_release(&swap_lock);
+
+  if (slot != SWAP_ERROR)
+    block_write_multiple(swap_device, slot * SECTORS_PER_SLOT, SECTORS_PER_SLOT, kpage);
+  return slot;
+}
+
+void swap_in(size_t slot, void* kpage) {
+  block_read_multiple(swap_device, slot * SECTORS_PER_SLOT, SECTORS_PER_SLOT, kpage);
+  swap_free(slot);
+}
+
+void swap_free(size_t slot) {
+  lock_acquire(&swap_lock);
+  ASSERT(bitmap_test(swap_slots, slot));
+  bitmap_reset(swap_slots, slot);
+  lock_release(&swap_lock);
+}
@@ -0,0 +1,23 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <bitmap.h>
+#include <stddef.h>
+
+/* Returned by swap_out() when no slot is free. */
+#define SWAP_ERROR BITMAP_ERROR
+
+/* Find the swap device and set up its slot map. */
+void swap_init(void);
+
+/* Write the page at KPAGE to a free slot and return the slot, or
+   SWAP_ERROR if there is no swap device or it is full. */
+size_t swap_out(const void* kpage);
+
+/* Read SLOT into the page at KPAGE and release the slot. */
+void swap_in(size_t slot, void* kpage);
+
+/* Release SLOT without reading it. */
+void swap_free(size_t slot);
+
+#endif /* vm/swap.h */